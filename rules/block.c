@@ -7,19 +7,37 @@ static bool disallow_empty;
 static bool disallow_short;
 static bool disallow_oneline;
 static bool require_decls_on_top;
-static char **allow_before_decls;
+static atom_t *allow_before_decls;
 
 
 #define start_of(tree) g_tokens[tree->start].start
 #define end_of(tree) g_tokens[tree->end].end
 
+static void set_allowed_before_decls(char **names)
+{
+    free_vec(allow_before_decls);
+    allow_before_decls = NULL;
+
+    if (!names)
+        return;
+
+    for (unsigned i = 0; i < vec_len(names); ++i)
+    {
+        atom_t atom = intern(names[i], strlen(names[i]));
+        atom_map_put(&allow_before_decls, atom, atom);
+    }
+
+    free_vec(names);
+}
+
+
 static void configure(void)
 {
     disallow_empty = cfg_boolean("disallow-empty");
     disallow_short = cfg_boolean("disallow-short");
     disallow_oneline = cfg_boolean("disallow-oneline");
     require_decls_on_top = cfg_boolean("require-decls-on-top");
-    allow_before_decls = cfg_strings("allow-before-decls");
+    set_allowed_before_decls(cfg_strings("allow-before-decls"));
 }
 
 
@@ -52,17 +70,8 @@ static bool in_decl_area(tree_t tree)
     if (tree->type == DECLARATION)
         return true;
 
-    if (tree->type == CALL && allow_before_decls)
-    {
-        token_t *name = &g_tokens[tree->start];
-        unsigned len = name->end.pos - name->start.pos + 1;
-
-        for (unsigned i = 0; i < vec_len(allow_before_decls); ++i)
-            if (!strncmp(allow_before_decls[i], name->start.pos, len))
-                return true;
-    }
-
-    return false;
+    return tree->type == CALL &&
+           atom_map_get(allow_before_decls, g_tokens[tree->start].atom);
 }
 
 
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "clint.h"
@@ -40,14 +41,20 @@ static void configure(void)
 }
 
 
-static struct {
+//! Marks of lines starting from `lines_base` (a window in case of parts).
+static struct line_s {
     unsigned push;
     unsigned pop;
     bool check;
 } *lines;
 
+static unsigned lines_base;
+static unsigned lines_size;
+static unsigned lines_capacity;     //!< It's kept for the next files.
 static unsigned *indent_stack;
 
+#define line_at(line) lines[(line) - lines_base]
+
 
 #define start_of(tree) g_tokens[(tree)->start].start.line
 #define end_of(tree) g_tokens[(tree)->end].end.line
@@ -61,21 +68,21 @@ static bool is_multiline(void *tree)
 
 static void mark_check(unsigned line)
 {
-    lines[line].check = true;
+    line_at(line).check = true;
 }
 
 
 static void mark_push(unsigned line)
 {
     assert(line < vec_len(g_lines));
-    ++lines[line].push;
+    ++line_at(line).push;
 }
 
 
 static void mark_pop(unsigned line)
 {
     assert(line < vec_len(g_lines));
-    ++lines[line].pop;
+    ++line_at(line).pop;
 }
 
 
@@ -101,7 +108,7 @@ static unsigned get_actual_indent(unsigned line)
 static unsigned get_expected_indent(unsigned line, unsigned actual)
 {
     assert(vec_len(indent_stack) > 0);
-    int pops = lines[line].pop;
+    int pops = line_at(line).pop;
 
     while (pops--)
         --vec_len(indent_stack);
@@ -112,7 +119,7 @@ static unsigned get_expected_indent(unsigned line, unsigned actual)
 
 static void push_expected_indent(unsigned line, unsigned prev)
 {
-    unsigned expected = prev + indent_size * lines[line].push;
+    unsigned expected = prev + indent_size * line_at(line).push;
     vec_push(indent_stack, expected);
 }
 
@@ -178,7 +185,7 @@ static void process_block(struct block_s *tree)
             if (nested)
                 mark_pop(start_of(entity));
 
-            nested = lines[start_of(get_deep_case(entity))].push > 0;
+            nested = line_at(start_of(get_deep_case(entity))).push > 0;
         }
 
         if (nested)
@@ -267,22 +274,57 @@ static void process_label(struct label_s *tree)
 {
     unsigned label_start = start_of(tree);
 
-    lines[label_start + 1].pop += lines[label_start].pop;
-    lines[label_start].pop = 0;
-    lines[label_start].check = 0;
+    line_at(label_start + 1).pop += line_at(label_start).pop;
+    line_at(label_start).pop = 0;
+    line_at(label_start).check = 0;
 
     if (get_actual_indent(label_start) != 0)
         add_warn(label_start, 0, "Label must stick to left");
 }
 
 
-static void check(void)
+/*!
+ * Marks may be set up to one line after the last token, so the window
+ * covers all lexed lines. Marks of lines after the part are kept.
+ */
+static void prepare_lines(void)
 {
-    lines = xcalloc(vec_len(g_lines), sizeof(*lines));
-    indent_stack = new_vec(unsigned, 8);
-    vec_push(indent_stack, 0);
+    unsigned size = vec_len(g_lines) + 1 - g_part.lines_from;
+    unsigned kept = 0;
 
-    mark_children(((struct transl_unit_s *)g_tree)->entities);
+    if (g_part.first)
+    {
+        lines_base = 0;
+
+        if (!indent_stack)
+            indent_stack = new_vec(unsigned, 8);
+
+        vec_len(indent_stack) = 0;
+        vec_push(indent_stack, 0);
+    }
+    else
+    {
+        unsigned shift = g_part.lines_from - lines_base;
+
+        kept = lines_size - shift;
+        memmove(lines, lines + shift, kept * sizeof(*lines));
+    }
+
+    if (size > lines_capacity)
+    {
+        lines = xrealloc(lines, size * sizeof(*lines));
+        lines_capacity = size;
+    }
+
+    memset(lines + kept, 0, (size - kept) * sizeof(*lines));
+    lines_base = g_part.lines_from;
+    lines_size = size;
+}
+
+
+static void check(void)
+{
+    prepare_lines();
 
     iterate_by_type(CASE, process_case);
     iterate_by_type(DEFAULT, process_case);
@@ -296,12 +338,16 @@ static void check(void)
     iterate_by_type(ENUM, process_enum);
     iterate_by_type(LABEL, process_label);
 
-    for (unsigned i = 0; i < vec_len(g_lines); ++i)
+    // Parents of entities are linked by the walk, even if no rule walked.
+    mark_children(((struct transl_unit_s *)g_tree)->entities);
+
+    for (unsigned i = g_part.lines_from; i < g_part.lines_to && !timed_out();
+         ++i)
     {
         unsigned actual = get_actual_indent(i);
         unsigned expected = get_expected_indent(i, actual);
 
-        if (lines[i].check)
+        if (line_at(i).check)
         {
             if (actual != expected)
                 add_warn(i, actual, indent_char == '\t' ?
@@ -313,12 +359,16 @@ static void check(void)
                          maximum_level);
         }
 
-        if (lines[i].push)
+        if (line_at(i).push)
             push_expected_indent(i, expected);
     }
 
-    free_vec(indent_stack);
-    free(lines);
+    if (g_part.last && lines_capacity * sizeof(*lines) > g_spare_limit)
+    {
+        free(lines);
+        lines = NULL;
+        lines_capacity = 0;
+    }
 }
 
 
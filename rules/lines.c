@@ -34,13 +34,16 @@ static unsigned utf8_len(const char *line, unsigned size)
 
 static void check(void)
 {
-    bool check_lb = !!line_break;
-    unsigned lb_length = check_lb ? strlen(line_break) : 0;
-    unsigned i = 0;
+    static bool check_lb;
+    unsigned lb_length = line_break ? strlen(line_break) : 0;
     const char *line;
-    unsigned length;
+    unsigned length, last;
 
-    for (; i < vec_len(g_lines); ++i)
+    if (g_part.first)
+        check_lb = !!line_break;
+
+    for (unsigned i = g_part.lines_from; i < g_part.lines_to && !timed_out();
+         ++i)
     {
         line = g_lines[i].start;
         length = g_lines[i].length;
@@ -70,8 +73,10 @@ static void check(void)
             }
     }
 
-    if (require_newline_at_eof && g_lines[i - 1].length > 0)
-        add_warn(i - 1, length, "Required newline at eof");
+    last = vec_len(g_lines) - 1;
+
+    if (require_newline_at_eof && g_part.last && g_lines[last].length > 0)
+        add_warn(last, g_lines[last].length, "Required newline at eof");
 }
 
 
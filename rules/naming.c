@@ -16,6 +16,7 @@ static bool allow_short_on_top;
 static bool allow_short_in_loop;
 static bool allow_short_in_block;
 static bool disallow_leading_underscore;
+static atom_t main_atom;
 
 
 static void configure(void)
@@ -39,35 +40,37 @@ static void configure(void)
     allow_short_in_loop = cfg_boolean("allow-short-in-loop");
     allow_short_in_block = cfg_boolean("allow-short-in-block");
     disallow_leading_underscore = cfg_boolean("disallow-leading-underscore");
+    main_atom = intern("main", 4);
 }
 
 
 static void check_name(toknum_t toknum, bool strict, char *prefix, char *suffix)
 {
     token_t *token;
-    int plen = 0, slen = 0;
+    int len, plen = 0, slen = 0;
 
     if (!toknum)
         return;
 
     token = &g_tokens[toknum];
+    len = token->end.pos - token->start.pos + 1;
 
     if (prefix)
     {
         plen = strlen(prefix);
-        if (memcmp(token->start.pos, prefix, plen))
+        if (len < plen || memcmp(token->start.pos, prefix, plen))
             add_warn_at(token->start, "Required \"%s\" prefix", prefix);
     }
 
     if (suffix)
     {
         slen = strlen(suffix);
-        if (memcmp(token->end.pos - slen + 1, suffix, slen))
+        if (len < slen || memcmp(token->end.pos - slen + 1, suffix, slen))
             add_warn_at(token->end, "Required \"%s\" suffix", suffix);
     }
 
     if (disallow_leading_underscore)
-        if (token->start.pos[0] == '_')
+        if (atom_shape(token->atom) & SHAPE_UNDERSCORE)
             add_warn_at(token->start, "Leading underscore is disallowed");
 
     if (style == UNDER_SCORE)
@@ -80,7 +83,7 @@ static void check_name(toknum_t toknum, bool strict, char *prefix, char *suffix)
             }
 
     if (strict && minimum_length)
-        if (token->end.pos - token->start.pos + 1 < minimum_length)
+        if (atom_length(token->atom) < minimum_length)
             add_warn_at(token->start, "Identifier should be at least %d",
                         minimum_length);
 }
@@ -156,9 +159,7 @@ static void process_decl(struct declaration_s *tree)
 
 static bool is_main(toknum_t name)
 {
-    token_t *token = &g_tokens[name];
-    return (token->end.pos - token->start.pos) == 3 &&
-           !memcmp("main", token->start.pos, 4);
+    return g_tokens[name].atom == main_atom;
 }
 
 
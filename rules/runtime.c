@@ -1,4 +1,3 @@
-#include <stdlib.h>
 #include <string.h>
 
 #include "clint.h"
@@ -9,10 +8,7 @@ static bool require_sized_int;
 static bool require_sizeof_as_fn;
 
 
-#define MAX_WORD_SZ 15
-
-// Must be sorted.
-static char threadunsafe[][MAX_WORD_SZ] = {
+static const char *threadunsafe_names[] = {
     "asctime",
     "ctime",
     "getgrgid",
@@ -28,8 +24,7 @@ static char threadunsafe[][MAX_WORD_SZ] = {
     "ttyname"
 };
 
-// Must be sorted by first.
-static char unsafe[][2][MAX_WORD_SZ] = {
+static const char *unsafe_names[][2] = {
     {"gets", "fgets"},
     {"sprintf", "snprintf"},
     {"strcat", "strncat"},
@@ -37,6 +32,15 @@ static char unsafe[][2][MAX_WORD_SZ] = {
     {"vsprintf", "vsnprintf"}
 };
 
+static atom_t *threadunsafe;
+static atom_t *unsafe;  //!< Maps to safe alternatives.
+
+
+static atom_t intern_str(const char *name)
+{
+    return intern(name, strlen(name));
+}
+
 
 static void configure(void)
 {
@@ -44,39 +48,40 @@ static void configure(void)
     require_safe_fn = cfg_boolean("require-safe-fn");
     require_sized_int = cfg_boolean("require-sized-int");
     require_sizeof_as_fn = cfg_boolean("require-sizeof-as-fn");
+
+    if (threadunsafe)
+        return;
+
+    for (unsigned i = 0;
+         i < sizeof(threadunsafe_names) / sizeof(*threadunsafe_names); ++i)
+    {
+        atom_t atom = intern_str(threadunsafe_names[i]);
+        atom_map_put(&threadunsafe, atom, atom);
+    }
+
+    for (unsigned i = 0; i < sizeof(unsafe_names) / sizeof(*unsafe_names); ++i)
+        atom_map_put(&unsafe, intern_str(unsafe_names[i][0]),
+                     intern_str(unsafe_names[i][1]));
 }
 
 
 static void process_call(struct call_s *tree)
 {
-    static char key[MAX_WORD_SZ];
     token_t *ident;
-    int len;
+    atom_t safe;
 
     if (tree->left->type != IDENTIFIER)
         return;
 
     ident = &g_tokens[tree->left->start];
-    len = ident->end.pos - ident->start.pos + 1;
 
-    memcpy(key, ident->start.pos, len);
-    key[len] = '\0';
-
-    if (require_threadsafe_fn &&
-        bsearch(key, threadunsafe, sizeof(threadunsafe) / sizeof(*threadunsafe),
-            sizeof(*threadunsafe), (int (*)(const void *, const void *))strcmp))
+    if (require_threadsafe_fn && atom_map_get(threadunsafe, ident->atom))
         add_warn_at(ident->start, "Consider using %s_r instead of %s",
-                    key, key);
-
-    if (require_safe_fn)
-    {
-        char *res = bsearch(key, unsafe, sizeof(unsafe) / sizeof(*unsafe),
-            sizeof(*unsafe), (int (*)(const void *, const void *))strcmp);
+                    atom_name(ident->atom), atom_name(ident->atom));
 
-        if (res)
-            add_warn_at(ident->start, "Consider using %s instead of %s",
-                        res + MAX_WORD_SZ, key);
-    }
+    if (require_safe_fn && (safe = atom_map_get(unsafe, ident->atom)))
+        add_warn_at(ident->start, "Consider using %s instead of %s",
+                    atom_name(safe), atom_name(ident->atom));
 }
 
 
@@ -191,7 +191,10 @@ static void check_newline_after(toknum_t i, int mode, const char *where)
 
 static char ch_from(unsigned line, unsigned column)
 {
-    return column < g_lines[line].length ? g_lines[line].start[column] : '\0';
+    if (line >= vec_len(g_lines) || column >= g_lines[line].length)
+        return '\0';
+
+    return g_lines[line].start[column];
 }
 
 
@@ -547,7 +550,8 @@ static void process_pointer(struct pointer_s *tree)
 
 static void check(void)
 {
-    for (toknum_t i = 2; i < vec_len(g_tokens) - 1; ++i)
+    for (toknum_t i = g_part.tokens_from; i < g_part.tokens_to && !timed_out();
+         ++i)
         check_token(i);
 
     iterate_by_type(BLOCK, process_block);
@@ -0,0 +1,215 @@
+/*!
+ * @brief It filters out known errors of rules by the baseline file.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clint.h"
+
+
+bool g_update_baseline = false;
+
+
+/*!
+ * Known errors are fingerprints: hashes of the file, the rule, the format of
+ * the message and the line w/o spaces, so they don't depend on line numbers
+ * and messages aren't formatted. The file is:
+ *   "CLB1" | u32 count | u64 fingerprints in ascending order
+ * Numbers are little-endian. Equal fingerprints (e.g. closing braces) are
+ * repeated, and each of them hides one error per file.
+ */
+static struct {
+    uint64_t *known;        //!< Sorted fingerprints.
+    unsigned count;
+    bool *used;             //!< Hid an error of the current file.
+    unsigned *used_list;    //!< Indices of `used` to reset.
+    uint64_t *found;        //!< Fingerprints to store in the update mode.
+} baseline;
+
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+static uint64_t hash_string(uint64_t hash, const char *str)
+{
+    for (; *str; ++str)
+        hash = (hash ^ (unsigned char)*str) * FNV_PRIME;
+
+    return (hash ^ 0xff) * FNV_PRIME;
+}
+
+
+static uint64_t fingerprint(unsigned line, const char *fmt)
+{
+    const char *filename = g_filename ? g_filename : "";
+    uint64_t hash = FNV_OFFSET;
+
+    assert(g_rule && line < vec_len(g_lines));
+
+    while (!strncmp(filename, "./", 2))
+        filename += 2;
+
+    hash = hash_string(hash, filename);
+    hash = hash_string(hash, g_rule);
+    hash = hash_string(hash, fmt);
+
+    for (unsigned i = 0; i < g_lines[line].length; ++i)
+        if (g_lines[line].start[i] != ' ' && g_lines[line].start[i] != '\t')
+            hash = (hash ^ (unsigned char)g_lines[line].start[i]) * FNV_PRIME;
+
+    return hash;
+}
+
+
+/*!
+ * Checks whether the error of the checked rule at `line` with the format
+ * `fmt` is known. All errors are known in the update mode, but remembered.
+ */
+bool is_known(unsigned line, const char *fmt)
+{
+    uint64_t hash;
+    unsigned lo = 0, hi = baseline.count;
+
+    if (!baseline.count && !g_update_baseline)
+        return false;
+
+    hash = fingerprint(line, fmt);
+
+    if (g_update_baseline)
+    {
+        vec_push(baseline.found, hash);
+        return true;
+    }
+
+    while (lo < hi)
+    {
+        unsigned mid = lo + (hi - lo) / 2;
+
+        if (baseline.known[mid] < hash)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    for (; lo < baseline.count && baseline.known[lo] == hash; ++lo)
+        if (!baseline.used[lo])
+        {
+            baseline.used[lo] = true;
+            vec_push(baseline.used_list, lo);
+            return true;
+        }
+
+    return false;
+}
+
+
+//! Known errors hide errors of each file anew.
+void reset_baseline(void)
+{
+    if (!baseline.used_list)
+        return;
+
+    for (unsigned i = 0; i < vec_len(baseline.used_list); ++i)
+        baseline.used[baseline.used_list[i]] = false;
+
+    vec_len(baseline.used_list) = 0;
+}
+
+
+static uint64_t get_u64(const unsigned char *bytes)
+{
+    uint64_t value = 0;
+
+    for (int i = 7; i >= 0; --i)
+        value = value << 8 | bytes[i];
+
+    return value;
+}
+
+
+static void put_u64(FILE *fp, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i, value >>= 8)
+        putc(value & 0xff, fp);
+}
+
+
+//! Loads the baseline, the missing file is empty in the update mode.
+bool load_baseline(const char *path)
+{
+    unsigned char header[8], bytes[8];
+    FILE *fp;
+
+    if (g_update_baseline)
+    {
+        baseline.found = new_vec(uint64_t, 1024);
+        return true;
+    }
+
+    if (!(fp = fopen(path, "rb")))
+        return false;
+
+    if (fread(header, 1, 8, fp) != 8 || memcmp(header, "CLB1", 4))
+        goto error;
+
+    baseline.count = header[4] | header[5] << 8 | header[6] << 16 |
+                     (uint32_t)header[7] << 24;
+    baseline.known = xmalloc((baseline.count + 1) * sizeof(uint64_t));
+    baseline.used = xcalloc(baseline.count + 1, sizeof(bool));
+    baseline.used_list = new_vec(unsigned, 64);
+
+    for (unsigned i = 0; i < baseline.count; ++i)
+    {
+        if (fread(bytes, 1, 8, fp) != 8)
+            goto error;
+
+        baseline.known[i] = get_u64(bytes);
+
+        if (i && baseline.known[i - 1] > baseline.known[i])
+            goto error;
+    }
+
+    fclose(fp);
+    return true;
+
+error:
+    fclose(fp);
+    baseline.count = 0;
+    return false;
+}
+
+
+static int compare_hashes(const void *a, const void *b)
+{
+    uint64_t left = *(const uint64_t *)a, right = *(const uint64_t *)b;
+    return left < right ? -1 : left > right;
+}
+
+
+//! Stores errors found in the update mode. Returns the number of them.
+int64_t store_baseline(const char *path)
+{
+    unsigned count = vec_len(baseline.found);
+    FILE *fp;
+
+    assert(g_update_baseline);
+
+    if (!(fp = fopen(path, "wb")))
+        return -1;
+
+    qsort(baseline.found, count, sizeof(uint64_t), compare_hashes);
+
+    fwrite("CLB1", 1, 4, fp);
+    for (int i = 0; i < 4; ++i)
+        putc(count >> i * 8 & 0xff, fp);
+
+    for (unsigned i = 0; i < count; ++i)
+        put_u64(fp, baseline.found[i]);
+
+    return fclose(fp) ? -1 : count;
+}
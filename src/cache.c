@@ -0,0 +1,572 @@
+/*!
+ * @brief It caches tokens, lines and trees of files by their content.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "clint.h"
+
+
+#define CACHE_VERSION 5
+
+const char *g_cache_dir = NULL;
+
+
+/*!
+ * An entry is a blob, where all pointers are offsets from its start:
+ *   header | data | lines | tokens | nodes and vectors of the tree | logs |
+ *   suppressions
+ * Offsets are replaced with pointers in place after mapping, so nothing is
+ * copied. Logs include errors of the parser regardless of --verbose.
+ */
+struct header_s {
+    char magic[8];
+    uint32_t version;
+    uint32_t word;          //!< The size of pointers.
+    uint64_t size;          //!< The size of the blob.
+    uint32_t max_depth;     //!< The tree depends on the limit.
+    uint32_t recoveries;
+    char *data;
+    line_t *lines;
+    token_t *tokens;
+    tree_t tree;
+    error_t *logs;
+    suppression_t *suppressions;
+};
+
+
+static const size_t node_sizes[] = {
+#define XX(type, name, word) [type] = sizeof(struct name ## _s),
+    NODE_MAP(XX)
+#undef XX
+};
+
+
+//! The mapped entry of the current file.
+static struct {
+    char *base;
+    size_t size;
+} mapping;
+
+
+static char *entry_path(void)
+{
+    static char *path = NULL;
+    size_t size;
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const char *ch = g_data; *ch; ++ch)
+        hash = (hash ^ (unsigned char)*ch) * 1099511628211ULL;
+
+    free(path);
+    size = strlen(g_cache_dir) + 18;
+    path = xmalloc(size);
+    snprintf(path, size, "%s/%016" PRIx64, g_cache_dir, hash);
+
+    return path;
+}
+
+
+//////////////
+// Storing. //
+//////////////
+
+static struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+    size_t *objects;    //!< Offsets of nodes and vectors in the walk order.
+    unsigned next;
+} blob;
+
+
+static size_t reserve(size_t size)
+{
+    size_t offset = (blob.len + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    if (offset + size > blob.capacity)
+    {
+        while (offset + size > blob.capacity)
+            blob.capacity *= 2;
+
+        blob.data = xrealloc(blob.data, blob.capacity);
+    }
+
+    blob.len = offset + size;
+    return offset;
+}
+
+
+static size_t put(const void *src, size_t size)
+{
+    size_t offset = reserve(size);
+    memcpy(blob.data + offset, src, size);
+    return offset;
+}
+
+
+static size_t put_vec(void *vec)
+{
+    size_t offset = reserve(vec_size(vec));
+    copy_vec(vec, blob.data + offset);
+    return offset + VEC_HEADER_SIZE;
+}
+
+
+#define at(offset) ((void *)(blob.data + (offset)))
+#define as_ptr(offset) ((void *)(uintptr_t)(offset))
+
+//! Pointers to the data are rebased onto the copy of the data.
+#define data_offset(ptr, data)                                                \
+    as_ptr((ptr) ? (data) + (size_t)((ptr) - g_data) : 0)
+
+
+static void *copy_object(void **ptr, bool node)
+{
+    size_t offset;
+
+    if (node)
+    {
+        offset = put(*ptr, node_sizes[((tree_t)*ptr)->type]);
+
+        // Parents are linked again after loading, as in the parser.
+        ((tree_t)at(offset))->parent = NULL;
+    }
+    else
+        offset = put_vec(*ptr);
+
+    vec_push(blob.objects, offset);
+    return *ptr;
+}
+
+
+static void *replace_by_offset(void **ptr, bool node)
+{
+    size_t offset = blob.objects[blob.next++];
+
+    *ptr = as_ptr(offset);
+    return blob.data + offset;
+}
+
+
+static bool write_entry(const char *path)
+{
+    size_t size = strlen(path) + 8;
+    char *tmp = xmalloc(size);
+    size_t written = 0;
+    int fd;
+
+    snprintf(tmp, size, "%s.XXXXXX", path);
+    mkdir(g_cache_dir, 0777);
+
+    if ((fd = mkstemp(tmp)) < 0)
+    {
+        free(tmp);
+        return false;
+    }
+
+    while (written < blob.len)
+    {
+        ssize_t res = write(fd, blob.data + written, blob.len - written);
+
+        if (res <= 0)
+            break;
+
+        written += res;
+    }
+
+    if (close(fd) || written < blob.len || rename(tmp, path))
+    {
+        unlink(tmp);
+        free(tmp);
+        return false;
+    }
+
+    free(tmp);
+    return true;
+}
+
+
+//! Stores the current file with `logs` of the parser.
+static void store_entry(error_t *logs)
+{
+    size_t header, data, lines, tokens, tree, errors, suppressions;
+    tree_t root;
+
+    if (!blob.data)
+    {
+        blob.capacity = 1 << 16;
+        blob.data = xmalloc(blob.capacity);
+        blob.objects = new_vec(size_t, 1024);
+    }
+
+    blob.len = 0;
+    blob.next = 0;
+    vec_len(blob.objects) = 0;
+
+    header = reserve(sizeof(struct header_s));
+    data = put(g_data, strlen(g_data) + 1);
+
+    lines = put_vec(g_lines);
+    for (unsigned i = 0; i < vec_len(g_lines); ++i)
+    {
+        line_t *line = (line_t *)at(lines) + i;
+        line->start = data_offset(line->start, data);
+    }
+
+    tokens = put_vec(g_tokens);
+    for (unsigned i = 0; i < vec_len(g_tokens); ++i)
+    {
+        token_t *token = (token_t *)at(tokens) + i;
+        token->start.pos = data_offset(token->start.pos, data);
+        token->end.pos = data_offset(token->end.pos, data);
+        token->atom = 0;
+    }
+
+    // Objects are copied in the walk order, so the walk over copies meets
+    // pointers to them in the same order.
+    root = g_tree;
+    relocate_tree(&g_tree, copy_object);
+    relocate_tree(&root, replace_by_offset);
+    tree = (uintptr_t)root;
+
+    errors = logs ? put_vec(logs) : 0;
+    for (unsigned i = 0; logs && i < vec_len(logs); ++i)
+    {
+        size_t message = put(logs[i].message, strlen(logs[i].message) + 1);
+        ((error_t *)at(errors))[i].message = as_ptr(message);
+    }
+
+    suppressions = g_suppressions ? put_vec(g_suppressions) : 0;
+
+    *(struct header_s *)at(header) = (struct header_s){
+        "clint", CACHE_VERSION, sizeof(void *), blob.len, g_max_depth,
+        g_recoveries, as_ptr(data), as_ptr(lines), as_ptr(tokens),
+        as_ptr(tree), as_ptr(errors), as_ptr(suppressions)
+    };
+
+    write_entry(entry_path());
+}
+
+
+//////////////
+// Loading. //
+//////////////
+
+#define rebase(ptr) ((ptr) = (void *)((ptr) ? mapping.base +                  \
+                                      (uintptr_t)(ptr) : NULL))
+
+#define offset_of(ptr) ((uintptr_t)(ptr))
+#define mapped(offset) ((void *)(mapping.base + (offset)))
+
+/*!
+ * Offsets of the entry are checked before they're followed, so a truncated
+ * or corrupted entry is parsed again instead of reading out of the mapping.
+ * Objects of the tree must follow each other in the walk order between
+ * tokens and logs, as they're stored, so they can't overlap or form cycles.
+ */
+static struct {
+    uintptr_t data;         //!< [data, data_end] is the content with NUL.
+    uintptr_t data_end;
+    size_t tokens;          //!< The number of tokens.
+    uintptr_t next;         //!< Where the next object of the tree can start.
+    uintptr_t end;          //!< Where objects of the tree end.
+    bool broken;
+} bounds;
+
+
+static bool in_mapping(uintptr_t offset, size_t size)
+{
+    return offset <= mapping.size && size <= mapping.size - offset;
+}
+
+
+static bool in_data(const char *pos)
+{
+    return offset_of(pos) >= bounds.data && offset_of(pos) <= bounds.data_end;
+}
+
+
+//! Checks the vector at `offset`, `elem_sz` is 0 for any size of elements.
+static bool valid_vec(uintptr_t offset, size_t elem_sz)
+{
+    size_t *header;
+
+    if (offset % sizeof(void *) || offset < VEC_HEADER_SIZE ||
+        !in_mapping(offset - VEC_HEADER_SIZE, VEC_HEADER_SIZE))
+        return false;
+
+    header = (size_t *)mapped(offset) - 3;
+
+    return header[0] && (!elem_sz || header[0] == elem_sz) &&
+           header[1] == header[2] &&
+           header[2] <= (mapping.size - offset) / header[0];
+}
+
+
+//! Checks the node at `offset` except its children.
+static bool valid_node(uintptr_t offset)
+{
+    tree_t tree = mapped(offset);
+
+    return !(offset % sizeof(void *)) && in_mapping(offset, sizeof(*tree)) &&
+           (unsigned)tree->type < sizeof(node_sizes) / sizeof(*node_sizes) &&
+           !tree->parent && tree->start < bounds.tokens &&
+           tree->end < bounds.tokens;
+}
+
+
+//! Checks the node or the vector at `offset` after the previous object.
+static bool valid_object(uintptr_t offset, bool node)
+{
+    uintptr_t start = node ? offset : offset - VEC_HEADER_SIZE;
+    size_t size;
+
+    if (!(node ? valid_node(offset) : valid_vec(offset, 0)))
+        return false;
+
+    size = node ? node_sizes[((tree_t)mapped(offset))->type]
+                : vec_size(mapped(offset)) - VEC_HEADER_SIZE;
+
+    if (start < bounds.next || offset > bounds.end ||
+        size > bounds.end - offset)
+        return false;
+
+    bounds.next = offset + size;
+    return true;
+}
+
+
+static void *replace_by_pointer(void **ptr, bool node)
+{
+    if (!valid_object(offset_of(*ptr), node))
+    {
+        bounds.broken = true;
+        return NULL;
+    }
+
+    return rebase(*ptr);
+}
+
+
+//! Checks offsets of the entry except the tree.
+static bool valid_entry(struct header_s *header)
+{
+    size_t len = strlen(g_data);
+    line_t *lines;
+    token_t *tokens;
+    error_t *logs;
+
+    bounds.data = offset_of(header->data);
+    bounds.data_end = bounds.data + len;
+
+    if (!in_mapping(bounds.data, len + 1) ||
+        memcmp(mapped(bounds.data), g_data, len + 1) ||
+        !valid_vec(offset_of(header->lines), sizeof(line_t)) ||
+        !valid_vec(offset_of(header->tokens), sizeof(token_t)))
+        return false;
+
+    if ((header->logs &&
+         !valid_vec(offset_of(header->logs), sizeof(error_t))) ||
+        (header->suppressions &&
+         !valid_vec(offset_of(header->suppressions), sizeof(suppression_t))))
+        return false;
+
+    lines = mapped(offset_of(header->lines));
+    tokens = mapped(offset_of(header->tokens));
+    logs = header->logs ? mapped(offset_of(header->logs)) : NULL;
+
+    for (unsigned i = 0; i < vec_len(lines); ++i)
+        if (!in_data(lines[i].start) ||
+            lines[i].length > bounds.data_end - offset_of(lines[i].start))
+            return false;
+
+    for (unsigned i = 0; i < vec_len(tokens); ++i)
+        if (!in_data(tokens[i].start.pos) || !in_data(tokens[i].end.pos) ||
+            offset_of(tokens[i].end.pos) + 1 < offset_of(tokens[i].start.pos))
+            return false;
+
+    // Logs are of the parser, so they have no rules.
+    for (unsigned i = 0; logs && i < vec_len(logs); ++i)
+        if (logs[i].rule || !in_mapping(offset_of(logs[i].message), 1) ||
+            !memchr(mapped(offset_of(logs[i].message)), '\0',
+                    mapping.size - offset_of(logs[i].message)))
+            return false;
+
+    bounds.tokens = vec_len(tokens);
+    bounds.next = offset_of(header->tokens) + vec_len(tokens) * sizeof(token_t);
+    bounds.broken = false;
+
+    if (header->logs)
+        bounds.end = offset_of(header->logs) - VEC_HEADER_SIZE;
+    else if (header->suppressions)
+        bounds.end = offset_of(header->suppressions) - VEC_HEADER_SIZE;
+    else
+        bounds.end = mapping.size;
+
+    return true;
+}
+
+
+static struct header_s *map_entry(const char *path)
+{
+    struct header_s *header;
+    struct stat info;
+    int fd;
+
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return NULL;
+
+    if (fstat(fd, &info) || info.st_size < (off_t)sizeof(*header))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    // Pages are private, so offsets can be replaced in place.
+    mapping.size = info.st_size;
+    mapping.base = mmap(NULL, mapping.size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping.base == MAP_FAILED)
+    {
+        mapping.base = NULL;
+        return NULL;
+    }
+
+    header = (struct header_s *)(void *)mapping.base;
+
+    if (memcmp(header->magic, "clint", 6) || header->version != CACHE_VERSION ||
+        header->word != sizeof(void *) || header->size != mapping.size ||
+        header->max_depth != g_max_depth || !valid_entry(header))
+    {
+        unmap_cache();
+        return NULL;
+    }
+
+    return header;
+}
+
+
+//! Uses the mapped entry as the current file, unless its tree is broken.
+static bool load_entry(struct header_s *header)
+{
+    error_t *logs = NULL;
+
+    rebase(header->lines);
+    rebase(header->tokens);
+    rebase(header->logs);
+    rebase(header->suppressions);
+
+    for (unsigned i = 0; i < vec_len(header->lines); ++i)
+        rebase(header->lines[i].start);
+
+    for (unsigned i = 0; i < vec_len(header->tokens); ++i)
+    {
+        token_t *token = &header->tokens[i];
+
+        rebase(token->start.pos);
+        rebase(token->end.pos);
+
+        if (token->kind == TOK_IDENTIFIER)
+            token->atom = intern(token->start.pos,
+                                 token->end.pos + 1 - token->start.pos);
+    }
+
+    relocate_tree(&header->tree, replace_by_pointer);
+
+    if (bounds.broken)
+        return false;
+
+    g_lines = header->lines;
+    g_tokens = header->tokens;
+    g_tree = header->tree;
+    g_suppressions = header->suppressions;
+    g_recoveries = header->recoveries;
+
+    // Messages are copied out of the mapping.
+    for (unsigned i = 0; header->logs && i < vec_len(header->logs); ++i)
+    {
+        error_t error = header->logs[i];
+
+        if (!error.stylistic && !(g_log_mode & LOG_VERBOSE))
+            continue;
+
+        if (!logs)
+            logs = new_vec(error_t, vec_len(header->logs));
+
+        error.message = copy_message(rebase(error.message));
+        vec_push(logs, error);
+    }
+
+    replay_logs(logs);
+    return true;
+}
+
+
+/*!
+ * Parses `g_data` or maps its tree from the cache, then the tree is stored to
+ * the cache. Tokens, lines and the tree of a mapped entry mustn't be freed.
+ */
+void parse_cached(void)
+{
+    enum log_mode_e mode = g_log_mode;
+    error_t *logs = NULL, **outer;
+    struct header_s *header;
+
+    assert(g_cache_dir && !mapping.base);
+
+    if ((header = map_entry(entry_path())) && load_entry(header))
+        return;
+
+    // A broken entry is replaced.
+    unmap_cache();
+
+    g_log_mode |= LOG_VERBOSE;
+    outer = collect_logs(&logs);
+    init_parser();
+    parse();
+    collect_logs(outer);
+    g_log_mode = mode;
+
+    // The tree of a file cut off by the timeout is incomplete.
+    if (g_tree && !timed_out())
+        store_entry(logs);
+
+    // Drop errors of the parser, if they aren't wanted.
+    if (logs && !(mode & LOG_VERBOSE))
+    {
+        unsigned kept = 0;
+
+        for (unsigned i = 0; i < vec_len(logs); ++i)
+            if (logs[i].stylistic)
+                logs[kept++] = logs[i];
+
+        vec_len(logs) = kept;
+    }
+
+    replay_logs(logs);
+}
+
+
+bool unmap_cache(void)
+{
+    if (!mapping.base)
+        return false;
+
+    munmap(mapping.base, mapping.size);
+    mapping.base = NULL;
+    return true;
+}
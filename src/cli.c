@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <dirent.h>
 #include <errno.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,8 +14,32 @@
 
 
 static enum {OK, IMPERFECT, MINOR_ERR, MAJOR_ERR} retval = OK;
-static enum {TOKENIZE, PARSE, CHECK} action = CHECK;
+static enum {TOKENIZE, PARSE, CHECK, MERGE, LSP} action = CHECK;
 static const char *config = ".clintrc";
+static bool streaming = false;
+static const char *format = "text";
+static enum dump_e dump_format = DUMP_TEXT;
+
+//! Files with markers in the first `MARKERS_WINDOW` bytes aren't checked.
+#define MARKERS_WINDOW 4096
+
+static const char *default_markers[] = {"clint: off", NULL};
+static const char **markers = default_markers;
+static int64_t max_file_size = 0;
+static unsigned skipped = 0;
+static unsigned timeouts = 0;   //!< Files cut off by --file-timeout.
+
+//! Files and lines changed by the diff of `--diff`.
+static const char *diff_path = NULL;
+static changed_t *changed = NULL;
+
+static range_t *ranges = NULL;  //!< Changed lines of the current file.
+
+static const char *baseline_path = NULL;
+static const char *tar_path = NULL;
+
+//! Files are discovered first and split by sizes, if `shard_count` is set.
+static unsigned shard_index, shard_count = 0;
 
 
 enum cmd_e {
@@ -25,7 +50,22 @@ enum cmd_e {
     CMD_VERBOSE,
     CMD_TOKENIZE,
     CMD_SHOW_TREE,
+    CMD_FORMAT,
     CMD_UNSORTED,
+    CMD_PIPELINE,
+    CMD_STREAM,
+    CMD_DIFF,
+    CMD_SHARD,
+    CMD_MERGE,
+    CMD_BASELINE,
+    CMD_UPDATE,
+    CMD_LSP,
+    CMD_TAR,
+    CMD_JOBS,
+    CMD_MAX_DEPTH,
+    CMD_MAX_SIZE,
+    CMD_FILE_TIMEOUT,
+    CMD_CACHE,
     CMD_HELP,
     CMD_VERSION
 };
@@ -41,16 +81,31 @@ struct option_s {
 
 
 static struct option_s options[] = {
-    {CMD_LIMIT,      "limit",     'l',  "The maximum number of errors", "NUM"},
-    {CMD_SHORTLY,    "shortly",   's',  "One-line output",               NULL},
-    {CMD_CONFIG,     "config",    'c',  "Use FILE instead .clintrc",   "FILE"},
-    {CMD_NO_COLORS,  "no-colors",   0,  "Disable colors for output",     NULL},
-    {CMD_VERBOSE,    "verbose",   'v',  "Output errors during parsing",  NULL},
-    {CMD_TOKENIZE,   "tokenize",    0,  "Tokenize file and exit",        NULL},
-    {CMD_SHOW_TREE,  "show-tree",   0,  "Parse file and exit",           NULL},
-    {CMD_UNSORTED,   "unsorted",    0,  "Disable output sorting",        NULL},
-    {CMD_HELP,       "help",      'h',  "Display this help and exit",    NULL},
-    {CMD_VERSION,    "version",   'V',  "Output version and exit",       NULL}
+    {CMD_LIMIT,      "limit",         'l',  "Maximum number of errors", "NUM"},
+    {CMD_SHORTLY,    "shortly",       's',  "One-line output",           NULL},
+    {CMD_CONFIG,     "config",        'c',  "Use FILE as config",      "FILE"},
+    {CMD_NO_COLORS,  "no-colors",       0,  "Disable colors for output", NULL},
+    {CMD_VERBOSE,    "verbose",       'v',  "Output errors of parsing",  NULL},
+    {CMD_TOKENIZE,   "tokenize",        0,  "Tokenize file and exit",    NULL},
+    {CMD_SHOW_TREE,  "show-tree",       0,  "Parse file and exit",       NULL},
+    {CMD_FORMAT,     "format",          0,  "Format of reports, dumps", "FMT"},
+    {CMD_UNSORTED,   "unsorted",        0,  "Disable output sorting",    NULL},
+    {CMD_PIPELINE,   "pipeline",        0,  "Lex in a separate thread",  NULL},
+    {CMD_STREAM,     "stream",          0,  "Check files part by part",  NULL},
+    {CMD_DIFF,       "diff",            0,  "Check changes of FILE",   "FILE"},
+    {CMD_SHARD,      "shard",           0,  "Check shard I of N",       "I/N"},
+    {CMD_MERGE,      "merge",           0,  "Merge results of shards",   NULL},
+    {CMD_BASELINE,   "baseline",        0,  "Skip errors in FILE",     "FILE"},
+    {CMD_UPDATE,     "update-baseline", 0,  "Store errors as baseline",  NULL},
+    {CMD_LSP,        "lsp",             0,  "Serve LSP over stdio",      NULL},
+    {CMD_TAR,        "tar",             0,  "Check files in tar FILE", "FILE"},
+    {CMD_JOBS,       "jobs",          'j',  "Threads for large files",  "NUM"},
+    {CMD_MAX_DEPTH,  "max-depth",       0,  "Nesting limit of parser",  "NUM"},
+    {CMD_MAX_SIZE,   "max-file-size",   0,  "Skip files of NUM+ bytes", "NUM"},
+    {CMD_FILE_TIMEOUT, "file-timeout",  0,  "Cut off files after MS",    "MS"},
+    {CMD_CACHE,      "cache",           0,  "Cache trees in DIR",       "DIR"},
+    {CMD_HELP,       "help",          'h',  "Display help and exit",     NULL},
+    {CMD_VERSION,    "version",       'V',  "Output version and exit",   NULL}
 };
 
 static int num_options = sizeof(options) / sizeof(*options);
@@ -62,7 +117,9 @@ static void display_help(void)
 
     printf("Usage:\n"
            "  clint [OPTION]... [FILE]...\n\n"
-           "Check style for the FILEs (the current directory by default).\n\n"
+           "Check style for the FILEs (the current directory by default).\n"
+           "Results of --shard are written in jsonl, FILEs of --merge are\n"
+           "such results. --lsp serves an editor instead of checking FILEs.\n\n"
            "Options:\n");
 
     for (int i = 0; i < num_options; ++i)
@@ -81,6 +138,14 @@ static void display_help(void)
             printf("--%-*s %s.\n", brief_offset - 5, opt->command, opt->brief);
     }
 
+    printf("\nFormats:\n"
+           "  text, jsonl, sarif or checkstyle for reports of errors,\n"
+           "  text, jsonl or binary for --tokenize and --show-tree.\n");
+
+    printf("\nConfigs:\n"
+           "  .clintrc of a directory overrides the config of its parent,\n"
+           "  null removes the inherited value.\n");
+
     printf("\nExit status:\n"
            "  0  if OK,\n"
            "  1  if style warnings or (when --verbose) errors,\n"
@@ -158,10 +223,111 @@ static void process_option(struct option_s *opt, const char *arg)
             action = PARSE;
             break;
 
+        case CMD_FORMAT:
+            format = arg;
+            break;
+
         case CMD_UNSORTED:
             g_log_mode &= ~LOG_SORTED;
             break;
 
+        case CMD_PIPELINE:
+            g_pipelined = true;
+            break;
+
+        case CMD_STREAM:
+            streaming = true;
+            break;
+
+        case CMD_DIFF:
+            diff_path = arg;
+            break;
+
+        case CMD_SHARD:
+            if (sscanf(arg, "%u/%u", &shard_index, &shard_count) < 2 ||
+                shard_index < 1 || shard_index > shard_count)
+            {
+                fprintf(stderr, "Invalid argument of --%s.\n", opt->command);
+                exit(MAJOR_ERR);
+            }
+            break;
+
+        case CMD_MERGE:
+            action = MERGE;
+            break;
+
+        case CMD_BASELINE:
+            baseline_path = arg;
+            break;
+
+        case CMD_UPDATE:
+            g_update_baseline = true;
+            break;
+
+        case CMD_LSP:
+            action = LSP;
+            break;
+
+        case CMD_TAR:
+            tar_path = arg;
+            break;
+
+        case CMD_JOBS:
+        {
+            int jobs;
+            if (sscanf(arg, "%d", &jobs) < 1 || jobs < 1)
+            {
+                fprintf(stderr, "Invalid argument of --%s.\n", opt->command);
+                exit(MAJOR_ERR);
+            }
+
+            g_jobs = jobs;
+            break;
+        }
+
+        case CMD_MAX_DEPTH:
+        {
+            int max_depth;
+            if (sscanf(arg, "%d", &max_depth) < 1 || max_depth < 1)
+            {
+                fprintf(stderr, "Invalid argument of --%s.\n", opt->command);
+                exit(MAJOR_ERR);
+            }
+
+            g_max_depth = max_depth;
+            break;
+        }
+
+        case CMD_MAX_SIZE:
+        {
+            int64_t size;
+            if (sscanf(arg, "%" SCNd64, &size) < 1 || size < 1)
+            {
+                fprintf(stderr, "Invalid argument of --%s.\n", opt->command);
+                exit(MAJOR_ERR);
+            }
+
+            max_file_size = size;
+            break;
+        }
+
+        case CMD_FILE_TIMEOUT:
+        {
+            int timeout;
+            if (sscanf(arg, "%d", &timeout) < 1 || timeout < 1)
+            {
+                fprintf(stderr, "Invalid argument of --%s.\n", opt->command);
+                exit(MAJOR_ERR);
+            }
+
+            g_file_timeout = timeout;
+            break;
+        }
+
+        case CMD_CACHE:
+            g_cache_dir = arg;
+            break;
+
         case CMD_HELP:
             display_help();
             exit(OK);
@@ -185,19 +351,94 @@ static bool accept(const char *fpath)
 }
 
 
+//! Checks the head of `data` of `size` for opt-out markers.
+static bool is_opted_out(const char *data, size_t size)
+{
+    return has_marker(data, size < MARKERS_WINDOW ? size : MARKERS_WINDOW,
+                      markers);
+}
+
+
 #define OK(x) if (!(x)) goto error
 
-static void process_file(const char *fpath)
+
+//////////////
+// Configs. //
+//////////////
+
+/*!
+ * Directories are configured by the nearest `.clintrc` of their ancestors,
+ * which overrides the parent config: objects are merged, `null` removes the
+ * inherited value. Every directory is resolved to its profile once, and rules
+ * are configured again only if the next file has another profile.
+ */
+static struct profile_s {
+    json_value *config;
+    const char **markers;
+} *active_profile = NULL;
+
+static struct profile_s root_profile;
+
+//! Resolved directories, the last one is looked up first.
+static struct dir_s {
+    char *path;
+    struct profile_s *profile;
+} *dirs = NULL;
+
+
+//! Reads "opt-out-markers" of `obj`, which replace the default ones.
+static const char **load_markers(json_value *obj)
+{
+    json_value *value = NULL;
+    const char **list;
+
+    for (unsigned i = 0; i < obj->u.object.length; ++i)
+        if (!strcmp(obj->u.object.values[i].name, "opt-out-markers"))
+            value = obj->u.object.values[i].value;
+
+    if (!value)
+        return default_markers;
+
+    if (value->type != json_array)
+        goto error;
+
+    list = xmalloc((value->u.array.length + 1) * sizeof(*list));
+
+    for (unsigned i = 0; i < value->u.array.length; ++i)
+    {
+        json_value *item = value->u.array.values[i];
+
+        if (item->type != json_string || !item->u.string.length)
+        {
+            free(list);
+            goto error;
+        }
+
+        list[i] = item->u.string.ptr;
+    }
+
+    list[value->u.array.length] = NULL;
+    return list;
+
+error:
+    fprintf(stderr, "\"opt-out-markers\" must be an array of strings.\n");
+    exit(MAJOR_ERR);
+}
+
+
+//! Reads the config at `path`, returns `NULL` if it's missing.
+static json_value *read_config(const char *path, bool optional)
 {
     FILE *fp;
     int size;
+    char *data;
+    char errbuf[512];
+    json_value *res;
 
-    if (!accept(fpath))
-        return;
-
-    g_filename = xstrdup(fpath);
+    if (!(fp = fopen(path, "r")) && optional && errno == ENOENT)
+        return NULL;
 
-    OK(fp = fopen(fpath, "rb"));
+    OK(fp);
 
     // Determine the size.
     OK(!fseek(fp, 0, SEEK_END));
@@ -205,37 +446,245 @@ static void process_file(const char *fpath)
     OK(!fseek(fp, 0, SEEK_SET));
 
     // Read all content from the file.
-    g_data = xmalloc(size + 1);
-    OK(fread(g_data, 1, size, fp) == (size_t)size);
-    g_data[size] = '\0';
+    data = xmalloc(size + 1);
+    data[size] = '\0';
 
+    OK(fread(data, 1, size, fp) == (size_t)size);
     OK(fclose(fp) != EOF);
 
+    // Parse file as json.
+    res = json_parse_ex(&(json_settings){
+        .settings = json_enable_comments
+    }, data, size, errbuf);
+
+    free(data);
+
+    if (!res || res->type != json_object)
+    {
+        printf("Error while parsing config %s: %s.\n", path,
+               res ? "must be an object" : errbuf);
+        exit(MAJOR_ERR);
+    }
+
+    return res;
+
+error:
+    fprintf(stderr, "%s: %s.\n", path, strerror(errno));
+    exit(MAJOR_ERR);
+}
+
+
+static json_value *find_value(json_value *object, const char *name)
+{
+    for (unsigned i = 0; i < object->u.object.length; ++i)
+        if (!strcmp(name, object->u.object.values[i].name))
+            return object->u.object.values[i].value;
+
+    return NULL;
+}
+
+
+//! Merges `over` into `base` w/o copying values, which are shared.
+static json_value *merge_configs(json_value *base, json_value *over)
+{
+    unsigned base_len, over_len, len = 0;
+    json_object_entry *values;
+    json_value *res;
+
+    if (base->type != json_object || over->type != json_object)
+        return over;
+
+    base_len = base->u.object.length;
+    over_len = over->u.object.length;
+    values = xmalloc((base_len + over_len + 1) * sizeof(*values));
+
+    for (unsigned i = 0; i < base_len + over_len; ++i)
+    {
+        json_object_entry entry = i < base_len ? base->u.object.values[i]
+                                    : over->u.object.values[i - base_len];
+        json_value *replacing;
+
+        // Entries of `over` replace the same ones of `base` in place.
+        if (i < base_len && (replacing = find_value(over, entry.name)))
+            entry.value = merge_configs(entry.value, replacing);
+        else if (i >= base_len && find_value(base, entry.name))
+            continue;
+
+        if (entry.value->type != json_null)
+            values[len++] = entry;
+    }
+
+    res = xcalloc(1, sizeof(*res));
+    res->type = json_object;
+    res->u.object.length = len;
+    res->u.object.values = values;
+
+    return res;
+}
+
+
+static bool activate_profile(struct profile_s *profile)
+{
+    g_config = profile->config;
+    markers = profile->markers;
+    active_profile = profile;
+
+    return configure_rules();
+}
+
+
+//! Resolves the directory of `len` first chars of `path`.
+static struct profile_s *resolve_dir(const char *path, unsigned len)
+{
+    struct profile_s *parent, *profile;
+    unsigned parent_len;
+    json_value *own;
+    char *dir, *config_path;
+    size_t size;
+
+    while (len > 1 && path[len - 1] == '/')
+        --len;
+
+    if (!len || (len == 1 && path[0] == '.'))
+        return &root_profile;
+
+    for (unsigned i = vec_len(dirs); i-- > 0;)
+        if (!strncmp(dirs[i].path, path, len) && !dirs[i].path[len])
+            return dirs[i].profile;
+
+    for (parent_len = len; parent_len > 0; --parent_len)
+        if (path[parent_len - 1] == '/')
+            break;
+
+    // The root of the filesystem has no parent directory.
+    parent = parent_len < len ? resolve_dir(path, parent_len) : &root_profile;
+
+    dir = xmalloc(len + 1);
+    memcpy(dir, path, len);
+    dir[len] = '\0';
+
+    size = len + sizeof("/.clintrc");
+    config_path = xmalloc(size);
+
+    if (snprintf(config_path, size, "%s/.clintrc", dir) >= (int)size)
+    {
+        fprintf(stderr, "%s: Too long path.\n", dir);
+        exit(MAJOR_ERR);
+    }
+
+    if ((own = read_config(config_path, true)))
+    {
+        profile = xmalloc(sizeof(*profile));
+        profile->config = merge_configs(parent->config, own);
+        profile->markers = load_markers(profile->config);
+
+        if (!activate_profile(profile))
+        {
+            fprintf(stderr, "%s: Invalid config.\n", config_path);
+            exit(MAJOR_ERR);
+        }
+    }
+    else
+        profile = parent;
+
+    free(config_path);
+    vec_push(dirs, ((struct dir_s){dir, profile}));
+
+    return profile;
+}
+
+
+//! Configures rules for the file at `path` by its directory.
+static void configure_for(const char *path)
+{
+    const char *slash = strrchr(path, '/');
+    struct profile_s *profile;
+
+    profile = resolve_dir(path, slash ? (unsigned)(slash - path + 1) : 0);
+
+    // Rules of every profile were configured once, so it cannot fail.
+    if (profile != active_profile && !activate_profile(profile))
+        assert(0);
+}
+
+
+//! Configures rules for a document of the language server.
+static bool prepare_document(const char *path, const char *data, size_t size)
+{
+    if (max_file_size && (int64_t)size > max_file_size)
+        return false;
+
+    configure_for(path);
+    return !is_opted_out(data, size);
+}
+
+
+static void load_config(void)
+{
+    root_profile.config = read_config(config, false);
+    root_profile.markers = load_markers(root_profile.config);
+
+    // Configure all rules.
+    if (!activate_profile(&root_profile))
+        exit(MAJOR_ERR);
+
+    dirs = new_vec(struct dir_s, 16);
+}
+
+
+//! Processes `g_data` of `g_filename` by the action.
+static void process_data(void)
+{
     // Do something.
     if (action == TOKENIZE)
     {
-        char *str;
         init_lexer();
         tokenize();
-        str = stringify_tokens();
-        printf("%s: (%lu tokens)\n%s\n", fpath, vec_len(g_tokens), str);
-        free(str);
+        dump_tokens(stdout, dump_format);
     }
     else if (action == PARSE)
     {
-        char *str;
         init_parser();
         parse();
-        str = stringify_tree();
-        printf("%s:\n%s\n", fpath, str);
-        free(str);
+        dump_tree(stdout, dump_format);
     }
     else
     {
         assert(action == CHECK);
-        init_parser();
-        parse();
-        check_rules();
+
+        if (g_file_timeout)
+            start_timer();
+
+        if (streaming && !ranges)
+        {
+            init_parser();
+            check_by_parts();
+        }
+        else
+        {
+            if (g_cache_dir)
+                parse_cached();
+            else
+            {
+                init_parser();
+                parse();
+            }
+
+            if (ranges)
+                check_ranges(ranges);
+            else
+                check_rules();
+        }
+
+        // Errors found before are kept, the notice is at the last token.
+        if (timed_out())
+        {
+            token_t *last = &g_tokens[vec_len(g_tokens) - 1];
+
+            add_warn_at(last->start, "Checking timed out after %u ms, "
+                        "the rest of the file is skipped", g_file_timeout);
+            ++timeouts;
+        }
     }
 
     if (g_log_mode & LOG_SORTED)
@@ -244,7 +693,67 @@ static void process_file(const char *fpath)
     if (g_errors && retval == OK)
         retval = IMPERFECT;
 
-    printf("Done processing %s.\n", fpath);
+    if (action == CHECK)
+        end_file_report();
+
+    // Only reports and dumps are written to stdout in other formats.
+    if (action == CHECK ? g_log_format == FORMAT_TEXT
+                        : dump_format == DUMP_TEXT)
+    {
+        if (g_log_mode & LOG_VERBOSE && g_recoveries)
+            printf("Recoveries from syntax errors: %u.\n", g_recoveries);
+
+        printf("Done processing %s.\n", g_filename);
+    }
+
+    reset_state();
+}
+
+
+static void process_file(const char *fpath)
+{
+    FILE *fp;
+    int size, head;
+
+    if (!accept(fpath))
+        return;
+
+    if (action == CHECK)
+        configure_for(fpath);
+
+    g_filename = xstrdup(fpath);
+
+    OK(fp = fopen(fpath, "rb"));
+
+    // Determine the size.
+    OK(!fseek(fp, 0, SEEK_END));
+    OK((size = ftell(fp)) >= 0);
+    OK(!fseek(fp, 0, SEEK_SET));
+
+    // Generated and vendored files are skipped before reading all content.
+    if (action == CHECK && max_file_size && size > max_file_size)
+        goto skip;
+
+    g_data = alloc_data(size + 1);
+    head = size < MARKERS_WINDOW ? size : MARKERS_WINDOW;
+    OK(fread(g_data, 1, head, fp) == (size_t)head);
+    g_data[head] = '\0';
+
+    if (action == CHECK && is_opted_out(g_data, head))
+        goto skip;
+
+    // Read the rest of content from the file.
+    OK(fread(g_data + head, 1, size - head, fp) == (size_t)(size - head));
+    g_data[size] = '\0';
+
+    OK(fclose(fp) != EOF);
+
+    process_data();
+    return;
+
+skip:
+    ++skipped;
+    fclose(fp);
     reset_state();
     return;
 
@@ -255,6 +764,98 @@ error:
 }
 
 
+///////////////////
+// Tar archives. //
+///////////////////
+
+//! Checks the current member of `tar` w/o extracting it.
+static bool process_member(tar_t *tar, const char *name, uint64_t size)
+{
+    if (!accept(name))
+        return skip_member(tar, size);
+
+    if (action == CHECK && max_file_size && size > (uint64_t)max_file_size)
+    {
+        ++skipped;
+        return skip_member(tar, size);
+    }
+
+    g_filename = xstrdup(name);
+    g_data = alloc_data(size + 1);
+
+    if (!read_member(tar, g_data, size))
+    {
+        reset_state();
+        return false;
+    }
+
+    if (action == CHECK && is_opted_out(g_data, size))
+    {
+        ++skipped;
+        reset_state();
+        return true;
+    }
+
+    process_data();
+    return true;
+}
+
+
+/*!
+ * Processes `.c` and `.h` members of the ustar archive at `tar_path` in a
+ * single sequential read, "-" is stdin. Long names of pax and GNU tar are
+ * supported. Reports contain paths inside the archive, and the root config
+ * is used for all of them.
+ */
+static void process_tar(void)
+{
+    FILE *fp = strcmp(tar_path, "-") ? fopen(tar_path, "rb") : stdin;
+    tar_t tar = {fp, NULL, NULL, false};
+    const char *name;
+    uint64_t size;
+    bool ok = true;
+
+    if (!fp)
+    {
+        fprintf(stderr, "%s: %s.\n", tar_path, strerror(errno));
+        retval = MINOR_ERR;
+        return;
+    }
+
+    while (ok && (name = next_member(&tar, &size)))
+        ok = process_member(&tar, name, size);
+
+    if (!ok || !tar.ended)
+    {
+        fprintf(stderr, "%s: Broken or truncated archive.\n", tar_path);
+        retval = MINOR_ERR;
+    }
+
+    free_tar(&tar);
+
+    if (fp != stdin)
+        fclose(fp);
+}
+
+
+/*!
+ * Processes files of the shard `shard_index` of discovered ones in the order
+ * of paths.
+ */
+static void process_shard(void)
+{
+    char **mine = take_shard(shard_index, shard_count);
+
+    for (unsigned i = 0; i < vec_len(mine); ++i)
+    {
+        process_file(mine[i]);
+        free(mine[i]);
+    }
+
+    free_vec(mine);
+}
+
+
 static void tree_walk(const char *path)
 {
     struct stat fstat;
@@ -265,7 +866,11 @@ static void tree_walk(const char *path)
 
     if (S_ISREG(fstat.st_mode))
     {
-        process_file(path);
+        if (shard_count && accept(path))
+            discover_file(path, fstat.st_size);
+        else if (!shard_count)
+            process_file(path);
+
         return;
     }
 
@@ -305,48 +910,114 @@ error:
 }
 
 
-static void load_config(void)
+//! Returns the index of `word` in `NULL`-terminated `words` or -1.
+static int index_of(const char *word, const char **words)
 {
-    FILE *fp;
-    int size;
-    char *data;
-    char errbuf[512];
+    for (int i = 0; words[i]; ++i)
+        if (!strcmp(word, words[i]))
+            return i;
 
-    OK(fp = fopen(config, "r"));
+    return -1;
+}
 
-    // Determine the size.
-    OK(!fseek(fp, 0, SEEK_END));
-    OK((size = ftell(fp)) >= 0);
-    OK(!fseek(fp, 0, SEEK_SET));
 
-    // Read all content from the file.
-    data = xmalloc(size + 1);
-    data[size] = '\0';
+//! Chooses the format of reports or dumps by `--format`.
+static bool choose_format(void)
+{
+    static const char *reports[] = {"text", "jsonl", "sarif", "checkstyle",
+                                    NULL};
+    static const char *dumps[] = {"text", "jsonl", "binary", NULL};
+    bool is_report = action == CHECK || action == MERGE;
+    int index = index_of(format, is_report ? reports : dumps);
 
-    OK(fread(data, 1, size, fp) == (size_t)size);
-    OK(fclose(fp) != EOF);
+    if (index < 0)
+        return false;
 
-    // Parse file as json.
-    g_config = json_parse_ex(&(json_settings){
-        .settings = json_enable_comments
-    }, data, size, errbuf);
+    if (is_report)
+        g_log_format = (enum log_format_e)index;
+    else
+        dump_format = (enum dump_e)index;
 
-    if (!g_config)
+    return true;
+}
+
+
+//! Reads the unified diff of `--diff`, "-" is stdin.
+static bool load_diff(void)
+{
+    FILE *fp = strcmp(diff_path, "-") ? fopen(diff_path, "r") : stdin;
+
+    if (!fp)
     {
-        printf("Error while parsing config while: %s.\n", errbuf);
-        exit(MAJOR_ERR);
+        fprintf(stderr, "%s: %s.\n", diff_path, strerror(errno));
+        return false;
     }
 
-    // Configure all rules.
-    if (!configure_rules())
-        exit(MAJOR_ERR);
+    changed = read_diff(fp, diff_path);
 
-    free(data);
-    return;
+    if (fp != stdin)
+        fclose(fp);
 
-error:
-    fprintf(stderr, "%s: %s.\n", config, strerror(errno));
-    exit(MAJOR_ERR);
+    return changed;
+}
+
+
+/////////////////////////
+// Merging of results. //
+/////////////////////////
+
+//! Reads the result of a shard at `path`, the worst status is returned.
+static bool load_result(const char *path)
+{
+    FILE *fp = fopen(path, "r");
+    int status;
+    bool complete;
+
+    if (!fp)
+    {
+        fprintf(stderr, "%s: %s.\n", path, strerror(errno));
+        return false;
+    }
+
+    complete = read_result(fp, &status) && status <= MAJOR_ERR;
+    fclose(fp);
+
+    if (!complete)
+    {
+        fprintf(stderr, "%s: Broken or incomplete result.\n", path);
+        return false;
+    }
+
+    if (status > retval)
+        retval = status;
+
+    return true;
+}
+
+
+/*!
+ * Reports errors of results of shards at `paths` sorted by files. Text
+ * reports are short, because sources may be absent on the merging node.
+ */
+static void merge_results(const char **paths)
+{
+    for (unsigned i = 0; i < vec_len(paths); ++i)
+        if (!load_result(paths[i]))
+            retval = MAJOR_ERR;
+
+    if (g_log_format == FORMAT_TEXT)
+        g_log_mode |= LOG_SHORTLY;
+
+    start_report();
+
+    while (take_merged())
+    {
+        print_errors_in_order();
+        end_file_report();
+        reset_state();
+    }
+
+    end_report();
 }
 
 
@@ -413,15 +1084,121 @@ int main(int argc, const char *argv[])
         }
     }
 
-    if (action == CHECK)
+    if (!choose_format())
+    {
+        fprintf(stderr, "Invalid argument of --format.\n");
+        return MAJOR_ERR;
+    }
+
+    if (diff_path && shard_count)
+    {
+        fprintf(stderr, "Options --diff and --shard are incompatible.\n");
+        return MAJOR_ERR;
+    }
+
+    if (tar_path && (diff_path || shard_count))
+    {
+        fprintf(stderr, "Option --tar is incompatible with --diff and "
+                        "--shard.\n");
+        return MAJOR_ERR;
+    }
+
+    if (action == MERGE)
+    {
+        merge_results(files);
+        return retval;
+    }
+
+    // Results of shards are merged from jsonl.
+    if (shard_count && action == CHECK)
+        g_log_format = FORMAT_JSONL;
+
+    if (g_update_baseline && !baseline_path)
+    {
+        fprintf(stderr, "Option --update-baseline requires --baseline.\n");
+        return MAJOR_ERR;
+    }
+
+    if (action == LSP && g_update_baseline)
+    {
+        fprintf(stderr, "Options --lsp and --update-baseline are "
+                        "incompatible.\n");
+        return MAJOR_ERR;
+    }
+
+    if (action == CHECK || action == LSP)
+    {
         load_config();
 
+        if (baseline_path && !load_baseline(baseline_path))
+        {
+            fprintf(stderr, "%s: Cannot load baseline.\n", baseline_path);
+            return MAJOR_ERR;
+        }
+
+        if (action == LSP)
+            return serve_lsp(prepare_document);
+
+        start_report();
+    }
+
     // Process files.
-    if (vec_len(files) == 0)
+    if (tar_path)
+        process_tar();
+    else if (vec_len(files) == 0)
         vec_push(files, ".");
 
-    for (unsigned i = 0; i < vec_len(files); ++i)
-        tree_walk(files[i]);
+    if (diff_path && action == CHECK)
+    {
+        if (!load_diff())
+            return MAJOR_ERR;
+
+        // Files without added lines have nothing to check.
+        for (unsigned i = 0; i < vec_len(changed); ++i)
+            if (vec_len(changed[i].ranges))
+            {
+                ranges = changed[i].ranges;
+                tree_walk(changed[i].path);
+            }
+
+        ranges = NULL;
+    }
+    else
+        for (unsigned i = 0; i < vec_len(files); ++i)
+            tree_walk(files[i]);
+
+    if (shard_count)
+        process_shard();
+
+    if (action == CHECK)
+    {
+        end_report();
+
+        if (skipped && g_log_format == FORMAT_TEXT)
+            printf("Skipped %u files by opt-out markers or size.\n", skipped);
+
+        if (timeouts && g_log_format == FORMAT_TEXT)
+            printf("Timed out %u files after %u ms.\n", timeouts,
+                   g_file_timeout);
+
+        if (g_update_baseline)
+        {
+            int64_t stored = store_baseline(baseline_path);
+
+            if (stored < 0)
+            {
+                fprintf(stderr, "%s: %s.\n", baseline_path, strerror(errno));
+                return MAJOR_ERR;
+            }
+
+            if (g_log_format == FORMAT_TEXT)
+                printf("Stored %" PRId64 " known errors to %s.\n", stored,
+                       baseline_path);
+        }
+    }
+
+    if (shard_count && action == CHECK)
+        printf("{\"status\": %d}\n", retval);
 
     return retval;
 }
@@ -9,6 +9,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
 #include <json.h>
 
@@ -27,7 +28,8 @@ typedef struct {
     bool stylistic;
     unsigned line;
     unsigned column;
-    char *message;
+    char *message;      //!< Valid until `release_messages()`.
+    const char *rule;   //!< `NULL` for errors of the lexer and the parser.
 } error_t;
 
 
@@ -42,6 +44,7 @@ extern tree_t g_tree;           //!< Tree of the current file.
 extern bool g_cached;           //!< The tree is cached or not.
 extern token_t *g_tokens;       //!< 1-indexed consumed tokens.
 extern error_t *g_errors;       //!< Errors and warnings.
+extern struct suppression_s *g_suppressions;    //!< Sorted by lines.
 extern json_value *g_config;    //!< Root of the config file.
 //!@}
 
@@ -60,8 +63,53 @@ struct rule_s {
 #define REGISTER_RULE(name, configure, check)                                 \
     struct rule_s name ## _rule = {#name, configure, check, NULL}
 
+/*!
+ * Rules check a part of the current file: `g_tree` contains entities of
+ * the part, lines and tokens are limited by the ranges. Tokens in the range
+ * always have both neighbours. The whole file is a single part, unless it's
+ * checked by `check_by_parts()`.
+ */
+typedef struct {
+    bool first;                 //!< No part was checked before.
+    bool last;                  //!< The part ends the file.
+    unsigned lines_from;        //!< [lines_from, lines_to) of `g_lines`.
+    unsigned lines_to;
+    toknum_t tokens_from;       //!< [tokens_from, tokens_to) of `g_tokens`.
+    toknum_t tokens_to;
+} part_t;
+
+extern part_t g_part;
+extern const char *g_rule;      //!< Name of the checked rule.
+
+//! Lines [from, to) of the current file.
+typedef struct {
+    unsigned from;
+    unsigned to;
+} range_t;
+
+//! Errors of rules are reported only at these lines, unless it's `NULL`.
+extern range_t *g_ranges;
+
 extern bool configure_rules(void);
 extern void check_rules(void);
+extern void check_part(void);
+
+/*!
+ * Suppressions are indexed by the lexer from comments like
+ * `// clint-disable-next-line naming, lines` and `clint-disable` ...
+ * `clint-enable` ranges, where no names mean all rules. The index is the
+ * vector of lines, where sets of suppressed rules change, so errors of rules
+ * are dropped by `add_log()` after the binary search.
+ */
+typedef struct suppression_s {
+    unsigned line;      //!< The first line of the boundary.
+    uint32_t range;     //!< Rules disabled by ranges (a bit per rule).
+    uint32_t once;      //!< Rules disabled only at this line.
+} suppression_t;
+
+extern void add_suppression(unsigned line, unsigned column, const char *text,
+                            const char *end);
+extern bool is_suppressed(unsigned line);
 
 extern void cfg_fatal(const char *prop, const char *message);
 extern json_type cfg_typeof(const char *prop);
@@ -72,14 +120,43 @@ extern char **cfg_strings(const char *prop);
 //!@}
 
 extern void reset_state(void);
+
+/*!
+ * @name Buffers to reuse.
+ * Buffers of a file are kept by `reset_state()` for the next file, unless
+ * they take more than `g_spare_limit` bytes.
+ */
+//!@{
+extern size_t g_spare_limit;
+
+extern struct spare_s {
+    line_t *lines;
+    token_t *tokens;
+    error_t *errors;
+} g_spare;
+
+extern char *alloc_data(size_t size);
+extern void release_data(char *data);
+//!@}
+
 extern void dispose_tree(tree_t tree);
+extern void shift_tree(tree_t tree, int delta);
+
+//! Gets a pointer to a node (or vector), returns the one to follow or `NULL`.
+typedef void *(*relocator_t)(void **ptr, bool node);
+extern void relocate_tree(tree_t *tree, relocator_t cb);
 
 
 extern const char *stringify_type(enum type_e type);
 extern const char *stringify_kind(enum token_e kind);
 
 extern char *stringify_tree(void);
-extern char *stringify_tokens(void);
+
+//! Formats of dumps of tokens and trees.
+enum dump_e {DUMP_TEXT, DUMP_JSONL, DUMP_BINARY};
+
+extern void dump_tokens(FILE *fp, enum dump_e format);
+extern void dump_tree(FILE *fp, enum dump_e format);
 
 
 /*!
@@ -93,11 +170,18 @@ extern void *xrealloc(void *ptr, size_t size);
 extern char *xstrdup(const char *src);
 //!@}
 
+extern void print_json_string(FILE *fp, const char *str, size_t len);
+extern json_value *find_field(json_value *obj, const char *name);
+extern bool read_line(FILE *fp, char **buf, size_t *capacity);
+
+#define has_type(value, kind) ((value) && (value)->type == json_ ## kind)
+
 
 /*!
  * @name Vector interface.
  */
 //!@{
+#define VEC_HEADER_SIZE (sizeof(size_t) * 3)
 #define new_vec(type, init_capacity) new_vec(sizeof(type), (init_capacity));
 #define vec_len(vec) (((size_t *)(void *)(vec))[-1])
 #define vec_push(vec, elem)                                                   \
@@ -109,6 +193,39 @@ extern char *xstrdup(const char *src);
 extern void *(new_vec)(size_t elem_sz, size_t init_capacity);
 extern void vec_expand_if_need(void **vec_ptr);
 extern void free_vec(void *vec);
+extern size_t vec_size(void *vec);
+extern void *copy_vec(void *vec, void *dest);
+
+#define reuse_vec(spare, type, capacity)                                      \
+    reuse_vec((void **)&(spare), sizeof(type), (capacity))
+#define keep_vec(spare, vec) keep_vec((void **)&(spare), (vec))
+
+extern void *(reuse_vec)(void **spare, size_t elem_sz, size_t capacity);
+extern void (keep_vec)(void **spare, void *vec);
+//!@}
+
+
+/*!
+ * @name Atoms.
+ * Identifiers are interned once per run, so equal names have equal atoms.
+ * Atom maps are vectors indexed by atoms, where 0 means a missing key.
+ */
+//!@{
+enum shape_e {
+    SHAPE_UPPER      = 1 << 0,  //!< Contains uppercase letters.
+    SHAPE_UNDERSCORE = 1 << 1,  //!< Starts with an underscore.
+    SHAPE_DIGIT      = 1 << 2   //!< Contains digits.
+};
+
+extern atom_t intern(const char *name, unsigned length);
+extern const char *atom_name(atom_t atom);
+extern unsigned atom_length(atom_t atom);
+extern unsigned atom_shape(atom_t atom);
+
+extern void atom_map_put(atom_t **map, atom_t key, atom_t value);
+
+#define atom_map_get(map, key)                                                \
+    ((map) && (key) < vec_len(map) ? (map)[key] : 0)
 //!@}
 
 
@@ -124,7 +241,15 @@ enum log_mode_e {
     LOG_COLOR   = 1 << 4
 };
 
+enum log_format_e {
+    FORMAT_TEXT,
+    FORMAT_JSONL,
+    FORMAT_SARIF,
+    FORMAT_CHECKSTYLE
+};
+
 extern enum log_mode_e g_log_mode;
+extern enum log_format_e g_log_format;
 extern unsigned g_log_limit;
 
 
@@ -137,7 +262,37 @@ extern void add_log(bool stylistic, unsigned line, unsigned column,
 #define add_error_at(loc, ...) add_error((loc).line, (loc).column, __VA_ARGS__)
 
 
+extern char *copy_message(const char *message);
+extern void release_messages(void);
+extern void renew_messages(error_t *errors);
+
+extern error_t **collect_logs(error_t **logs);
+extern void replay_logs(error_t *logs);
+extern void drop_logs(error_t *logs);
 extern void print_errors_in_order(void);
+
+extern void start_report(void);
+extern void end_file_report(void);
+extern void end_report(void);
+//!@}
+
+
+/*!
+ * @name Time budget of a file.
+ * Loops of the lexer, the parser and rules poll `timed_out()` at checkpoints,
+ * so the file is cut off without signals: the lexer reaches EOF early, the
+ * parser stops and rules return. Once it's true, it stays true for the file.
+ */
+//!@{
+extern unsigned g_file_timeout;     //!< In milliseconds, 0 for no limit.
+
+//! Polled along with the clock, returns true to cut off the file too.
+extern bool (*g_interrupter)(void);
+
+extern void start_timer(void);
+extern bool (timed_out)(void);
+
+#define timed_out() ((g_file_timeout || g_interrupter) && (timed_out)())
 //!@}
 
 
@@ -148,6 +303,8 @@ extern void print_errors_in_order(void);
 extern void init_lexer(void);
 extern void pull_token(token_t *token);
 extern void tokenize(void);
+
+extern bool has_marker(const char *data, size_t size, const char **markers);
 //!@}
 
 
@@ -155,8 +312,101 @@ extern void tokenize(void);
  * @name Parser.
  */
 //!@{
+extern bool g_pipelined;  //!< Lex in a separate thread while parsing.
+extern unsigned g_jobs;   //!< Threads to parse large files.
+
+//! Deeper nesting is a syntax error, so the call stack is bounded.
+extern unsigned g_max_depth;
+
+//! Recoveries from syntax errors in the current file.
+extern __thread unsigned g_recoveries;
+
 extern void init_parser(void);
 extern void parse(void);
+extern void check_by_parts(void);
+extern void check_ranges(range_t *ranges);
+extern bool check_changes(char *data);
+//!@}
+
+
+/*!
+ * @name Baseline of known errors.
+ */
+//!@{
+extern bool g_update_baseline;  //!< Store errors instead of reporting.
+
+extern bool load_baseline(const char *path);
+extern int64_t store_baseline(const char *path);
+extern bool is_known(unsigned line, const char *fmt);
+extern void reset_baseline(void);
+//!@}
+
+
+/*!
+ * @name Diffs of `--diff`.
+ */
+//!@{
+//! Lines added to the file at `path`.
+typedef struct {
+    char *path;
+    range_t *ranges;
+} changed_t;
+
+extern changed_t *read_diff(FILE *fp, const char *name);
+extern void free_diff(changed_t *changed);
+//!@}
+
+
+/*!
+ * @name Shards of `--shard` and merging of their results.
+ */
+//!@{
+extern void discover_file(const char *path, uint64_t size);
+extern char **take_shard(unsigned index, unsigned count);
+
+extern bool read_result(FILE *fp, int *status);
+extern bool take_merged(void);
+//!@}
+
+
+/*!
+ * @name Tar archives of `--tar`.
+ */
+//!@{
+//! The archive read from `fp`, other fields are zeroed at first.
+typedef struct {
+    FILE *fp;
+    char *name;         //!< Of the current member.
+    char *long_name;    //!< Of pax and GNU tar for the next member.
+    bool ended;         //!< By zero blocks.
+} tar_t;
+
+extern const char *next_member(tar_t *tar, uint64_t *size);
+extern bool read_member(tar_t *tar, char *data, uint64_t size);
+extern bool skip_member(tar_t *tar, uint64_t size);
+extern void free_tar(tar_t *tar);
+//!@}
+
+
+/*!
+ * @name Language server of `--lsp`.
+ */
+//!@{
+//! Configures rules for the file at `path`, returns false to skip it.
+typedef bool (*preparer_t)(const char *path, const char *data, size_t size);
+
+extern int serve_lsp(preparer_t preparer);
+//!@}
+
+
+/*!
+ * @name Cache of parsed files.
+ */
+//!@{
+extern const char *g_cache_dir;   //!< Where to cache, if not `NULL`.
+
+extern void parse_cached(void);
+extern bool unmap_cache(void);
 //!@}
 
 
@@ -0,0 +1,129 @@
+/*!
+ * @brief It reads lines added by unified diffs of `--diff`.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clint.h"
+
+
+//! Parses "START[,COUNT]" of the header of a hunk.
+static const char *parse_hunk_range(const char *str, unsigned *start,
+                                    unsigned *count)
+{
+    *count = 1;
+
+    if (sscanf(str, "%u", start) < 1)
+        return NULL;
+
+    str += strspn(str, "0123456789");
+
+    if (*str == ',' && sscanf(++str, "%u", count) < 1)
+        return NULL;
+
+    return str + strspn(str, "0123456789");
+}
+
+
+static void add_changed_line(changed_t *file, unsigned line)
+{
+    unsigned len = vec_len(file->ranges);
+
+    if (len && file->ranges[len - 1].to == line)
+        ++file->ranges[len - 1].to;
+    else
+        vec_push(file->ranges, ((range_t){line, line + 1}));
+}
+
+
+/*!
+ * Reads the unified diff from `fp`, `name` is used in errors. Only added lines
+ * of new files count: removed lines have nothing to check. Returns `NULL` if
+ * a hunk is invalid.
+ */
+changed_t *read_diff(FILE *fp, const char *name)
+{
+    changed_t *changed = new_vec(changed_t, 16);
+    changed_t *file = NULL;
+    unsigned line = 0, old_left = 0, new_left = 0;
+    bool prefixed = false;
+    size_t capacity = 0;
+    char *buf = NULL;
+
+    while (read_line(fp, &buf, &capacity))
+    {
+        // Lines of a hunk.
+        if (old_left || new_left)
+        {
+            // Lines of context can be empty without the leading space.
+            if (buf[0] == '+')
+                add_changed_line(file, line++);
+            else if (buf[0] != '-' && buf[0] != '\\')
+                ++line;
+
+            if (buf[0] != '+' && buf[0] != '\\' && old_left)
+                --old_left;
+
+            if (buf[0] != '-' && buf[0] != '\\' && new_left)
+                --new_left;
+
+            continue;
+        }
+
+        if (!strncmp(buf, "--- ", 4))
+            prefixed = !strncmp(buf + 4, "a/", 2) ||
+                       !strncmp(buf + 4, "/dev/null", 9);
+        else if (!strncmp(buf, "+++ ", 4))
+        {
+            char *path = buf + 4;
+            range_t *lines;
+
+            path[strcspn(path, "\t\r")] = '\0';
+            file = NULL;
+
+            if (!strcmp(path, "/dev/null"))
+                continue;
+
+            if (prefixed && !strncmp(path, "b/", 2))
+                path += 2;
+
+            lines = new_vec(range_t, 8);
+            vec_push(changed, ((changed_t){xstrdup(path), lines}));
+            file = &changed[vec_len(changed) - 1];
+        }
+        else if (!strncmp(buf, "@@ -", 4) && file)
+        {
+            unsigned old_start, new_start;
+            const char *rest = parse_hunk_range(buf + 4, &old_start, &old_left);
+
+            if (!rest || strncmp(rest, " +", 2) ||
+                !parse_hunk_range(rest + 2, &new_start, &new_left))
+            {
+                fprintf(stderr, "%s: Invalid hunk \"%s\".\n", name, buf);
+                free_diff(changed);
+                changed = NULL;
+                break;
+            }
+
+            line = new_start ? new_start - 1 : 0;
+        }
+    }
+
+    free(buf);
+    return changed;
+}
+
+
+void free_diff(changed_t *changed)
+{
+    for (unsigned i = 0; i < vec_len(changed); ++i)
+    {
+        free(changed[i].path);
+        free_vec(changed[i].ranges);
+    }
+
+    free_vec(changed);
+}
@@ -15,353 +15,241 @@
 
 enum item_e {TOKEN, TOKENS, NODE, NODES};
 
+//! A field of nodes, see `NODE_MAP`.
+struct field_s {
+    const char *prop;
+    unsigned char what;
+    uint16_t offset;
+};
+
+//! Fields of each type in the walk order, terminated by `NULL` props.
+static const struct {
+    const char *word;
+    const struct field_s *fields;
+} schema[] = {
+#define FIELD(name, kind, prop)                                               \
+    {#prop, kind, offsetof(struct name ## _s, prop)},
+#define XX(type, name, word)                                                  \
+    {word, (const struct field_s []){type ## _FIELDS(FIELD, name) {NULL}}},
+    NODE_MAP(XX)
+#undef XX
+#undef FIELD
+};
+
+#define field_of(tree, field) ((void *)((char *)(tree) + (field)->offset))
+
+
 typedef bool (*before_t)(const char *prop, enum item_e what, void *raw);
 typedef void (*after_t)(const char *prop, enum item_e what, void *raw);
 
 
-static void iterate_node_inner(void *raw, before_t before, after_t after);
+//! Pointers are passed through it before they're followed, if it's set.
+static relocator_t relocator = NULL;
 
-static void iterate(tree_t parent, const char *prop, enum item_e what,
-                    void *raw, before_t before, after_t after)
+#define follow(ptr, node)                                                     \
+    (relocator ? relocator((void **)&(ptr), node) : (ptr))
+
+//! An item to visit or to leave.
+struct frame_s {
+    tree_t parent;
+    const char *prop;
+    enum item_e what;
+    bool leaving;
+    void *raw;
+    void **link;        //!< Where `raw` is followed from, if it's set.
+};
+
+
+static void push_frame(struct frame_s **stack, tree_t parent, const char *prop,
+                       enum item_e what, void *raw, void **link)
 {
-    assert(raw);
+    struct frame_s *frames = *stack;
+    vec_push(frames, ((struct frame_s){parent, prop, what, false, raw, link}));
+    *stack = frames;
+}
 
-    if (before)
-    {
-        if (what == NODE && !((tree_t)raw)->parent)
-            ((tree_t)raw)->parent = parent;
 
-        if (!before(prop, what, raw))
-            return;
-    }
+static void push_children(struct frame_s **stack, void *raw);
 
-    switch (what)
+//! Pushes items of the node or the vector in order.
+static void push_items(struct frame_s **stack, const struct frame_s *frame)
+{
+    switch (frame->what)
     {
         case TOKEN:
             break;
 
         case NODE:
-            iterate_node_inner(raw, before, after);
+            push_children(stack, frame->raw);
             break;
 
         case TOKENS:
-            for (unsigned i = 0; i < vec_len(raw); ++i)
-                iterate(NULL, NULL, TOKEN, &((toknum_t *)raw)[i],
-                        before, after);
+            for (unsigned i = 0; i < vec_len(frame->raw); ++i)
+                push_frame(stack, NULL, NULL, TOKEN,
+                           &((toknum_t *)frame->raw)[i], NULL);
             break;
 
         case NODES:
-            for (unsigned i = 0; i < vec_len(raw); ++i)
-                iterate(parent, NULL, NODE, ((tree_t *)raw)[i], before, after);
+            for (unsigned i = 0; i < vec_len(frame->raw); ++i)
+                push_frame(stack, frame->parent, NULL, NODE, NULL,
+                           (void **)&((tree_t *)frame->raw)[i]);
             break;
 
         default:
             assert(0);
     }
-
-    if (after)
-        after(prop, what, raw);
 }
 
 
-static inline void iterate_node_inner(void *raw, before_t before, after_t after)
+/*!
+ * Walks items depth-first in pre-order for `before` and in post-order for
+ * `after`. The stack of items is explicit, so long chains of operators or
+ * "else if" don't overflow the call stack.
+ */
+static void iterate(tree_t parent, const char *prop, enum item_e what,
+                    void *raw, before_t before, after_t after)
 {
+    struct frame_s *stack = new_vec(struct frame_s, 64);
 
-#define token(prop)                                                           \
-    if (tree->prop)                                                           \
-        iterate(NULL, #prop, TOKEN, &tree->prop, before, after)
-
-#define ITERATE(prop, what)                                                   \
-    if (tree->prop)                                                           \
-        iterate((tree_t)tree, #prop, what, tree->prop, before, after)
-
-#define tokens(prop)    ITERATE(prop, TOKENS)
-#define node(prop)      ITERATE(prop, NODE)
-#define nodes(prop)     ITERATE(prop, NODES)
+    assert(raw);
+    push_frame(&stack, parent, prop, what, raw, NULL);
 
-    switch (((tree_t)raw)->type)
+    while (vec_len(stack) > 0)
     {
-        case TRANSL_UNIT:
-        case BLOCK:
-        {
-            struct transl_unit_s *tree = raw;
-            nodes(entities);
-            break;
-        }
-        case DECLARATION:
-        {
-            struct declaration_s *tree = raw;
-            node(specs);
-            nodes(decls);
-            break;
-        }
-        case SPECIFIERS:
-        {
-            struct specifiers_s *tree = raw;
-            token(storage);
-            token(fnspec);
-            tokens(quals);
-            node(dirtype);
-            nodes(attrs);
-            break;
-        }
-        case DECLARATOR:
-        {
-            struct declarator_s *tree = raw;
-            node(indtype);
-            token(name);
-            node(init);
-            node(bitsize);
-            nodes(attrs);
-            break;
-        }
-        case FUNCTION_DEF:
-        {
-            struct function_def_s *tree = raw;
-            node(specs);
-            node(decl);
-            nodes(old_decls);
-            node(body);
-            break;
-        }
-        case PARAMETER:
-        case TYPE_NAME:
-        {
-            struct parameter_s *tree = raw;
-            node(specs);
-            node(decl);
-            break;
-        }
-        case ATTRIBUTE:
-        {
-            struct attribute_s *tree = raw;
-            nodes(attribs);
-            break;
-        }
-        case ATTRIB:
-        {
-            struct attrib_s *tree = raw;
-            token(name);
-            nodes(args);
-            break;
-        }
-        case ID_TYPE:
-        {
-            struct id_type_s *tree = raw;
-            tokens(names);
-            break;
-        }
-        case STRUCT:
-        case UNION:
-        {
-            struct struct_s *tree = raw;
-            token(name);
-            nodes(members);
-            break;
-        }
-        case ENUM:
-        {
-            struct enum_s *tree = raw;
-            token(name);
-            nodes(values);
-            break;
-        }
-        case ENUMERATOR:
-        {
-            struct enumerator_s *tree = raw;
-            token(name);
-            node(value);
-            break;
-        }
-        case POINTER:
-        {
-            struct pointer_s *tree = raw;
-            node(indtype);
-            node(specs);
-            break;
-        }
-        case ARRAY:
-        {
-            struct array_s *tree = raw;
-            node(indtype);
-            node(dim_specs);
-            node(dim);
-            break;
-        }
-        case FUNCTION:
-        {
-            struct function_s *tree = raw;
-            node(indtype);
-            nodes(params);
-            break;
-        }
-        case IF:
-        case CONDITIONAL:
-        {
-            struct if_s *tree = raw;
-            node(cond);
-            node(then_br);
-            node(else_br);
-            break;
-        }
-        case SWITCH:
-        case WHILE:
-        case DO_WHILE:
-        {
-            struct switch_s *tree = raw;
-            node(cond);
-            node(body);
-            break;
-        }
-        case FOR:
-        {
-            struct for_s *tree = raw;
-            node(init);
-            node(cond);
-            node(next);
-            node(body);
-            break;
-        }
-        case GOTO:
-        {
-            struct goto_s *tree = raw;
-            token(label);
-            break;
-        }
-        case BREAK:
-        case CONTINUE:
-        case EMPTY:
-            break;
-        case RETURN:
-        {
-            struct return_s *tree = raw;
-            node(result);
-            break;
-        }
-        case LABEL:
-        {
-            struct label_s *tree = raw;
-            token(name);
-            node(stmt);
-            break;
-        }
-        case DEFAULT:
-        {
-            struct default_s *tree = raw;
-            node(stmt);
-            break;
-        }
-        case CASE:
-        {
-            struct case_s *tree = raw;
-            node(expr);
-            node(stmt);
-            break;
-        }
-        case CONSTANT:
-        case IDENTIFIER:
-        case SPECIAL:
-        {
-            struct constant_s *tree = raw;
-            token(value);
-            break;
-        }
+        struct frame_s frame = vec_pop(stack);
+        size_t mark;
 
-        case ACCESSOR:
-        {
-            struct accessor_s *tree = raw;
-            node(left);
-            token(op);
-            token(field);
-            break;
-        }
-        case COMMA:
-        {
-            struct comma_s *tree = raw;
-            nodes(exprs);
-            break;
-        }
-        case CALL:
+        if (frame.leaving)
         {
-            struct call_s *tree = raw;
-            node(left);
-            nodes(args);
-            break;
+            after(frame.prop, frame.what, frame.raw);
+            continue;
         }
-        case CAST:
-        {
-            struct cast_s *tree = raw;
-            node(type_name);
-            node(expr);
-            break;
-        }
-        case SUBSCRIPT:
-        {
-            struct subscript_s *tree = raw;
-            node(left);
-            node(index);
-            break;
-        }
-        case UNARY:
+
+        if (frame.link &&
+            !(frame.raw = follow(*frame.link, frame.what == NODE)))
+            continue;
+
+        if (before)
         {
-            struct unary_s *tree = raw;
-            token(op);
-            node(expr);
-            break;
+            if (frame.what == NODE && !((tree_t)frame.raw)->parent)
+                ((tree_t)frame.raw)->parent = frame.parent;
+
+            if (!before(frame.prop, frame.what, frame.raw))
+                continue;
         }
-        case BINARY:
-        case ASSIGNMENT:
+
+        if (after)
         {
-            struct binary_s *tree = raw;
-            node(left);
-            token(op);
-            node(right);
-            break;
+            push_frame(&stack, frame.parent, frame.prop, frame.what,
+                       frame.raw, NULL);
+            stack[vec_len(stack) - 1].leaving = true;
         }
-        case COMP_LITERAL:
+
+        mark = vec_len(stack);
+        push_items(&stack, &frame);
+
+        // Children are pushed in order, but popped in reverse.
+        for (size_t i = mark, j = vec_len(stack); i < j--; ++i)
         {
-            struct comp_literal_s *tree = raw;
-            node(type_name);
-            nodes(members);
-            break;
+            struct frame_s tmp = stack[i];
+            stack[i] = stack[j];
+            stack[j] = tmp;
         }
-        case COMP_MEMBER:
+    }
+
+    free_vec(stack);
+}
+
+
+static void push_children(struct frame_s **stack, void *raw)
+{
+    const struct field_s *field = schema[((tree_t)raw)->type].fields;
+
+    for (; field->prop; ++field)
+    {
+        void *item = field_of(raw, field);
+
+        if (field->what == TOKEN)
         {
-            struct comp_member_s *tree = raw;
-            nodes(designs);
-            node(init);
-            break;
+            if (*(toknum_t *)item)
+                push_frame(stack, NULL, field->prop, TOKEN, item, NULL);
         }
+        else if (*(void **)item)
+            push_frame(stack, raw, field->prop, field->what, NULL, item);
     }
 }
 
 
-static struct {
-    enum type_e type;
-    tree_t *cache[COMP_MEMBER + 1];
-} iterator = {0};
+//! Pushes `count` children of `parent`, linking them to it if needed.
+static void push_nodes(tree_t **stack, tree_t parent, tree_t *children,
+                       unsigned count)
+{
+    tree_t *nodes = *stack;
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (!children[i]->parent)
+            children[i]->parent = parent;
 
+        vec_push(nodes, children[i]);
+    }
+
+    *stack = nodes;
+}
 
-static bool iterate_by_type_before_cb(const char *prop, enum item_e what,
-                                      void *raw)
+
+/*!
+ * Calls `cb` for nodes in pre-order. Unlike `iterate()`, only nodes are
+ * visited, and the children are taken before `cb`, so it can free the node.
+ * Parents are linked, if they aren't yet.
+ */
+static void walk_nodes(tree_t tree, visitor_t cb)
 {
-    switch (what)
+    tree_t *stack = new_vec(tree_t, 64);
+
+    vec_push(stack, tree);
+
+    while (vec_len(stack) > 0)
     {
-        case TOKENS:
-        case TOKEN:
-            return false;
+        tree_t node = vec_pop(stack);
+        const struct field_s *field = schema[node->type].fields;
+        size_t mark = vec_len(stack);
 
-        case NODES:
-            return true;
+        for (; field->prop; ++field)
+        {
+            void *item = field_of(node, field);
 
-        case NODE:
-            if (((tree_t)raw)->type == iterator.type)
-                vec_push(iterator.cache[iterator.type], raw);
+            if (field->what == NODE)
+                push_nodes(&stack, node, item, *(tree_t *)item ? 1 : 0);
+            else if (field->what == NODES && *(tree_t **)item)
+                push_nodes(&stack, node, *(tree_t **)item,
+                           vec_len(*(tree_t **)item));
+        }
 
-            return true;
+        // Children are pushed in order, but popped in reverse.
+        for (size_t i = mark, j = vec_len(stack); i < j--; ++i)
+        {
+            tree_t tmp = stack[i];
+            stack[i] = stack[j];
+            stack[j] = tmp;
+        }
+
+        cb(node);
     }
 
-    assert(0);
+    free_vec(stack);
+}
+
+
+//! Nodes of each type in pre-order.
+static struct {
+    tree_t *cache[COMP_MEMBER + 1];
+} iterator = {{0}};
+
+
+static void iterate_by_type_cb(tree_t tree)
+{
+    vec_push(iterator.cache[tree->type], tree);
 }
 
 
@@ -369,43 +257,33 @@ void (iterate_by_type)(enum type_e type, visitor_t cb)
 {
     assert(cb);
 
+    // Nodes of all types are collected by one walk.
     if (!g_cached)
     {
         g_cached = true;
         for (int i = 0; i <= COMP_MEMBER; ++i)
-        {
-            free_vec(iterator.cache[i]);
-            iterator.cache[i] = NULL;
-        }
-    }
+            if (iterator.cache[i])
+                vec_len(iterator.cache[i]) = 0;
+            else
+                iterator.cache[i] = new_vec(tree_t, 32);
 
-    if (!iterator.cache[type])
-    {
-        iterator.cache[type] = new_vec(tree_t, 32);
-        iterator.type = type;
-        iterate(NULL, NULL, NODE, g_tree, iterate_by_type_before_cb, NULL);
+        walk_nodes(g_tree, iterate_by_type_cb);
     }
 
     for (unsigned i = 0, len = vec_len(iterator.cache[type]); i < len; ++i)
+    {
+        if (timed_out())
+            break;
+
         cb(iterator.cache[type][i]);
+    }
 }
 
 
 const char *stringify_type(enum type_e type)
 {
-    static const char *words[] = {
-        "transl-unit", "empty", "declaration", "specifiers", "declarator",
-        "function-def", "parameter", "type-name", "attribute", "attrib",
-        "id-type", "struct", "union", "enum", "enumerator", "pointer", "array",
-        "function", "block", "if", "switch", "while", "do-while", "for", "goto",
-        "break", "continue", "return", "label", "default", "case", "constant",
-        "identifier", "special", "accessor", "comma", "call", "cast",
-        "conditional", "subscript", "unary", "binary", "assignment",
-        "comp-literal", "comp-member"
-    };
-
-    assert(0 <= type && type < sizeof(words) / sizeof(*words));
-    return words[type];
+    assert(0 <= type && type < sizeof(schema) / sizeof(*schema));
+    return schema[type].word;
 }
 
 
@@ -424,6 +302,7 @@ const char *stringify_kind(enum token_e kind)
 
 #define STR_INIT_SIZE 8192
 
+static FILE *out = NULL;    //!< Where to print, otherwise `str` is built.
 static char *str = NULL;
 static int str_size;
 static int str_len;
@@ -442,12 +321,20 @@ __attribute__((format(printf, 1, 2)))
 static void push(const char *format, ...)
 {
     assert(format);
-    assert(str);
+    assert(str || out);
 
     va_list arg;
     int need;
     int avail = str_size - str_len;
 
+    if (out)
+    {
+        va_start(arg, format);
+        vfprintf(out, format, arg);
+        va_end(arg);
+        return;
+    }
+
     // Try to add to the buffer.
     va_start(arg, format);
     need = vsnprintf(str + str_len, avail, format, arg) + 1;
@@ -472,9 +359,7 @@ static void push(const char *format, ...)
 
 static void push_indent(void)
 {
-    push("\n");
-    for (int i = 0; i < indent; ++i)
-        push("    ");
+    push("\n%*s", indent * 4, "");
 }
 
 
@@ -536,32 +421,387 @@ char *stringify_tree(void)
 }
 
 
-char *stringify_tokens(void)
+//////////////
+// Dumping. //
+//////////////
+
+/*
+ * Dumps are written straight to the stream, so memory doesn't depend on
+ * the size of the file. JSON Lines dumps start with a line of the file:
+ *   {"file": "a.c", "tokens": 3}
+ *   {"kind": "int", "line": 1, "column": 1, "end_line": 1, ..., "text": "int"}
+ *   {"file": "a.c"}
+ *   {"id": 0, "parent": null, "prop": null, "type": "transl-unit", ...}
+ *   {"id": 1, "parent": 0, "prop": "entities", "type": "declaration", ...}
+ * where nodes are in pre-order, lines and columns are 1-based, and tokens
+ * of nodes are given by their text.
+ *
+ * Binary dumps consist of little-endian integers (u8, u16 and u32) and
+ * strings (u32 length and bytes), locations are 0-based:
+ *   tokens: "CLT1", path, u32 count, count * {u16 kind, u32 line,
+ *           u32 column, u32 end line, u32 end column}
+ *   tree:   "CLN1", path, nodes in pre-order {u8 type, u8 index of the field
+ *           of the parent, u32 id of the parent (all ones for the root),
+ *           u32 line, u32 column, u32 end line, u32 end column, the token
+ *           fields of the type in the order of `tree.h`: TOKEN as a string
+ *           (empty if missing), TOKENS as u32 count and strings}, u8 255 at
+ *           the end. Ids are numbers of nodes in pre-order.
+ */
+
+static void put_u8(FILE *fp, unsigned value)
+{
+    putc(value & 0xff, fp);
+}
+
+
+static void put_u16(FILE *fp, unsigned value)
+{
+    putc(value & 0xff, fp);
+    putc(value >> 8 & 0xff, fp);
+}
+
+
+static void put_u32(FILE *fp, uint32_t value)
+{
+    put_u16(fp, value & 0xffff);
+    put_u16(fp, value >> 16);
+}
+
+
+static void put_string(FILE *fp, const char *string, size_t len)
+{
+    put_u32(fp, len);
+    fwrite(string, 1, len, fp);
+}
+
+
+#define token_text(tok) (tok)->start.pos, (tok)->end.pos + 1 - (tok)->start.pos
+
+//! Missing tokens are written as empty strings.
+static void put_tokens(FILE *fp, const toknum_t *tokens, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        if (tokens[i])
+            put_string(fp, token_text(&g_tokens[tokens[i]]));
+        else
+            put_u32(fp, 0);
+}
+
+
+static void dump_token(FILE *fp, enum dump_e format, token_t *tok)
 {
+    switch (format)
+    {
+        case DUMP_TEXT:
+            fprintf(fp, "%s ", stringify_kind(tok->kind));
+            break;
+
+        case DUMP_JSONL:
+            fprintf(fp, "{\"kind\": ");
+            fprintf(fp, "\"%s\"", stringify_kind(tok->kind));
+            fprintf(fp, ", \"line\": %u, \"column\": %u, \"end_line\": %u, "
+                    "\"end_column\": %u, \"text\": ", tok->start.line + 1,
+                    tok->start.column + 1, tok->end.line + 1,
+                    tok->end.column + 1);
+
+            if (tok->kind == TOK_EOF)
+                fprintf(fp, "\"\"}\n");
+            else
+            {
+                print_json_string(fp, token_text(tok));
+                fprintf(fp, "}\n");
+            }
+            break;
+
+        case DUMP_BINARY:
+            put_u16(fp, tok->kind);
+            put_u32(fp, tok->start.line);
+            put_u32(fp, tok->start.column);
+            put_u32(fp, tok->end.line);
+            put_u32(fp, tok->end.column);
+            break;
+    }
+}
+
+
+//! Dumps tokens of `tokenize()`.
+void dump_tokens(FILE *fp, enum dump_e format)
+{
+    unsigned count = vec_len(g_tokens);
+
     assert(g_tokens);
-    str_init();
 
-    for (unsigned i = 1; i < vec_len(g_tokens); ++i)
+    switch (format)
     {
-        const char *kind = stringify_kind(g_tokens[i].kind);
-        push("%s ", kind);
+        case DUMP_TEXT:
+            fprintf(fp, "%s: (%u tokens)\n", g_filename, count);
+            break;
+
+        case DUMP_JSONL:
+            fprintf(fp, "{\"file\": ");
+            print_json_string(fp, g_filename, strlen(g_filename));
+            fprintf(fp, ", \"tokens\": %u}\n", count);
+            break;
+
+        case DUMP_BINARY:
+            fwrite("CLT1", 1, 4, fp);
+            put_string(fp, g_filename, strlen(g_filename));
+            put_u32(fp, count);
+            break;
     }
 
-    return str;
+    for (unsigned i = 0; i < count; ++i)
+        dump_token(fp, format, &g_tokens[i]);
+
+    if (format == DUMP_TEXT)
+        fprintf(fp, "\n");
 }
 
 
+//! A node to dump, its parent is dumped already.
+struct dumped_s {
+    tree_t tree;
+    unsigned parent;        //!< `NO_PARENT` for the root.
+    int index;              //!< Of the field of the parent.
+    const char *prop;
+};
 
-static void dispose_cb(const char *prop, enum item_e what, void *raw)
+#define NO_PARENT 0xffffffff
+
+
+static void dump_node(FILE *fp, enum dump_e format, struct dumped_s *node,
+                      unsigned id)
 {
-    if (what == NODE)
-        free(raw);
-    else if (what == NODES || what == TOKENS)
-        free_vec(raw);
+    tree_t tree = node->tree;
+    const struct field_s *field = schema[tree->type].fields;
+    token_t *start = &g_tokens[tree->start], *end = &g_tokens[tree->end];
+
+    if (format == DUMP_JSONL)
+    {
+        fprintf(fp, "{\"id\": %u, \"parent\": ", id);
+
+        if (node->prop)
+            fprintf(fp, "%u, \"prop\": \"%s\"", node->parent, node->prop);
+        else
+            fprintf(fp, "null, \"prop\": null");
+
+        fprintf(fp, ", \"type\": \"%s\", \"line\": %u, \"column\": %u, "
+                "\"end_line\": %u, \"end_column\": %u",
+                schema[tree->type].word, start->start.line + 1,
+                start->start.column + 1, end->end.line + 1,
+                end->end.column + 1);
+    }
+    else
+    {
+        put_u8(fp, tree->type);
+        put_u8(fp, node->index < 0 ? 0xff : node->index);
+        put_u32(fp, node->parent);
+        put_u32(fp, start->start.line);
+        put_u32(fp, start->start.column);
+        put_u32(fp, end->end.line);
+        put_u32(fp, end->end.column);
+    }
+
+    for (; field->prop; ++field)
+    {
+        void *item = field_of(tree, field);
+        toknum_t *tokens = item;
+        unsigned count = 1;
+
+        if (field->what == TOKENS)
+        {
+            tokens = *(toknum_t **)item;
+            count = tokens ? vec_len(tokens) : 0;
+        }
+        else if (field->what != TOKEN)
+            continue;
+
+        if (format == DUMP_BINARY)
+        {
+            if (field->what == TOKENS)
+                put_u32(fp, count);
+
+            put_tokens(fp, tokens, count);
+            continue;
+        }
+
+        if (field->what == TOKEN && !*tokens)
+            continue;
+
+        fprintf(fp, ", \"%s\": %s", field->prop,
+                field->what == TOKENS ? "[" : "");
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (i > 0)
+                fprintf(fp, ", ");
+
+            print_json_string(fp, token_text(&g_tokens[tokens[i]]));
+        }
+
+        if (field->what == TOKENS)
+            fprintf(fp, "]");
+    }
+
+    if (format == DUMP_JSONL)
+        fprintf(fp, "}\n");
+}
+
+
+static void dump_nodes(FILE *fp, enum dump_e format)
+{
+    struct dumped_s *stack = new_vec(struct dumped_s, 64);
+    unsigned id = 0;
+
+    vec_push(stack, ((struct dumped_s){g_tree, NO_PARENT, -1, NULL}));
+
+    while (vec_len(stack) > 0)
+    {
+        struct dumped_s node = vec_pop(stack);
+        const struct field_s *fields = schema[node.tree->type].fields;
+        size_t mark = vec_len(stack);
+
+        dump_node(fp, format, &node, id);
+
+        for (int i = 0; fields[i].prop; ++i)
+        {
+            void *item = field_of(node.tree, &fields[i]);
+            tree_t *children;
+            unsigned count;
+
+            if (fields[i].what == NODE)
+            {
+                children = item;
+                count = *children ? 1 : 0;
+            }
+            else if (fields[i].what == NODES && *(tree_t **)item)
+            {
+                children = *(tree_t **)item;
+                count = vec_len(children);
+            }
+            else
+                continue;
+
+            for (unsigned j = 0; j < count; ++j)
+                vec_push(stack, ((struct dumped_s){
+                    children[j], id, i, fields[i].prop
+                }));
+        }
+
+        // Children are pushed in order, but popped in reverse.
+        for (size_t i = mark, j = vec_len(stack); i < j--; ++i)
+        {
+            struct dumped_s tmp = stack[i];
+            stack[i] = stack[j];
+            stack[j] = tmp;
+        }
+
+        ++id;
+    }
+
+    free_vec(stack);
+}
+
+
+void dump_tree(FILE *fp, enum dump_e format)
+{
+    assert(g_tree);
+
+    switch (format)
+    {
+        case DUMP_TEXT:
+            fprintf(fp, "%s:\n", g_filename);
+            out = fp;
+            indent = 0;
+            iterate(NULL, NULL, NODE, g_tree, stringify_before_cb,
+                    stringify_after_cb);
+            out = NULL;
+            fprintf(fp, "\n");
+            break;
+
+        case DUMP_JSONL:
+            fprintf(fp, "{\"file\": ");
+            print_json_string(fp, g_filename, strlen(g_filename));
+            fprintf(fp, "}\n");
+            dump_nodes(fp, format);
+            break;
+
+        case DUMP_BINARY:
+            fwrite("CLN1", 1, 4, fp);
+            put_string(fp, g_filename, strlen(g_filename));
+            dump_nodes(fp, format);
+            put_u8(fp, 0xff);
+            break;
+    }
+}
+
+
+static void dispose_cb(tree_t tree)
+{
+    const struct field_s *field = schema[tree->type].fields;
+
+    for (; field->prop; ++field)
+        if (field->what == NODES || field->what == TOKENS)
+            free_vec(*(void **)field_of(tree, field));
+
+    free(tree);
 }
 
 
 void dispose_tree(tree_t tree)
 {
-    iterate(NULL, NULL, NODE, tree, NULL, dispose_cb);
+    walk_nodes(tree, dispose_cb);
+}
+
+
+static int shift;
+
+static void shift_cb(tree_t tree)
+{
+    const struct field_s *field = schema[tree->type].fields;
+
+    tree->start += shift;
+    tree->end += shift;
+
+    for (; field->prop; ++field)
+    {
+        toknum_t *tokens = field_of(tree, field);
+        unsigned count = 1;
+
+        if (field->what == TOKENS)
+        {
+            tokens = *(toknum_t **)tokens;
+            count = tokens ? vec_len(tokens) : 0;
+        }
+        else if (field->what != TOKEN || !*tokens)
+            continue;
+
+        for (unsigned i = 0; i < count; ++i)
+            tokens[i] += shift;
+    }
+}
+
+
+void shift_tree(tree_t tree, int delta)
+{
+    shift = delta;
+    walk_nodes(tree, shift_cb);
+}
+
+
+/*!
+ * Passes pointers to nodes and vectors of the tree, including `*tree`, to
+ * `cb` in pre-order. The tree is walked by pointers returned by `cb`, items
+ * are skipped if it returns `NULL`.
+ */
+void relocate_tree(tree_t *tree, relocator_t cb)
+{
+    void *root;
+
+    relocator = cb;
+
+    if ((root = cb((void **)tree, true)))
+        iterate(NULL, NULL, NODE, root, NULL, NULL);
+
+    relocator = NULL;
 }
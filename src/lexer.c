@@ -4,13 +4,19 @@
  */
 
 #include <assert.h>
-#include <ctype.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "clint.h"
 
+#if defined(__GNUC__) && defined(__SSE2__) &&                                 \
+    (defined(__x86_64__) || defined(__i386__))
+#define LEXER_SIMD
+#include <immintrin.h>
+#endif
+
 
 /*!
  * @name The lexer state
@@ -18,96 +24,188 @@
  */
 //!@{
 static char *ch;
+static char **splices;
+static char **splice;
 
 static bool parsing_header_name;
 static bool parsing_pp_directive;
 //!@}
 
 
+static void choose_scanners(void);
+static void find_splices(void);
+static void fill_word_tables(void);
+
+
 #define error(...)                                                            \
     (add_error(vec_len(g_lines) - 1, ch - g_lines[vec_len(g_lines) - 1].start,\
                __VA_ARGS__), false)
 
 
+//! Average sizes of lines and tokens to guess capacities by the data.
+#define BYTES_PER_LINE  24
+#define BYTES_PER_TOKEN 5
+
+
+/*!
+ * Prepares `g_lines` and the empty `g_tokens` with capacities guessed by
+ * the size of the data, so they rarely grow.
+ */
 void init_lexer(void)
 {
+    size_t size;
+
     assert(g_data);
-    assert(!g_lines);
+    assert(!g_lines && !g_tokens && !g_suppressions);
+
+    size = strlen(g_data);
+    g_lines = reuse_vec(g_spare.lines, line_t, size / BYTES_PER_LINE + 128);
+    g_tokens = reuse_vec(g_spare.tokens, token_t,
+                         size / BYTES_PER_TOKEN + 1024);
 
-    g_lines = new_vec(line_t, 128);
     vec_push(g_lines, ((line_t){g_data, 0, false}));
 
+    choose_scanners();
+    fill_word_tables();
+
     ch = g_data;
     parsing_header_name = false;
     parsing_pp_directive = false;
+
+    find_splices();
 }
 
 
-/**
- * Well, there is no need to use a perfect hash function (e.g. by `gperf`),
- * because it's not a bottleneck.
- *
- * Instead, we have sorted search tables for both case (for keywords and
- * preprocessor keywords) and use a binary search.
+/*!
+ * @name Character classes
+ * Unlike <ctype.h>, the table doesn't depend on the current locale.
+ */
+//!@{
+enum {
+    C_SPACE  = 1 << 0,
+    C_DIGIT  = 1 << 1,
+    C_XDIGIT = 1 << 2,
+    C_ALPHA  = 1 << 3,
+    C_WORD   = 1 << 4      //!< [a-zA-Z0-9_]
+};
+
+#define S C_SPACE
+#define D (C_DIGIT|C_XDIGIT|C_WORD)
+#define X (C_ALPHA|C_XDIGIT|C_WORD)
+#define A (C_ALPHA|C_WORD)
+
+static const unsigned char classes[256] = {
+    ['\t'] = S, ['\n'] = S, ['\v'] = S, ['\f'] = S, ['\r'] = S, [' '] = S,
+
+    ['0'] = D, ['1'] = D, ['2'] = D, ['3'] = D, ['4'] = D,
+    ['5'] = D, ['6'] = D, ['7'] = D, ['8'] = D, ['9'] = D,
+
+    ['A'] = X, ['B'] = X, ['C'] = X, ['D'] = X, ['E'] = X, ['F'] = X,
+    ['G'] = A, ['H'] = A, ['I'] = A, ['J'] = A, ['K'] = A, ['L'] = A,
+    ['M'] = A, ['N'] = A, ['O'] = A, ['P'] = A, ['Q'] = A, ['R'] = A,
+    ['S'] = A, ['T'] = A, ['U'] = A, ['V'] = A, ['W'] = A, ['X'] = A,
+    ['Y'] = A, ['Z'] = A,
+
+    ['a'] = X, ['b'] = X, ['c'] = X, ['d'] = X, ['e'] = X, ['f'] = X,
+    ['g'] = A, ['h'] = A, ['i'] = A, ['j'] = A, ['k'] = A, ['l'] = A,
+    ['m'] = A, ['n'] = A, ['o'] = A, ['p'] = A, ['q'] = A, ['r'] = A,
+    ['s'] = A, ['t'] = A, ['u'] = A, ['v'] = A, ['w'] = A, ['x'] = A,
+    ['y'] = A, ['z'] = A,
+
+    ['_'] = C_WORD
+};
+
+#undef S
+#undef D
+#undef X
+#undef A
+
+#define in_class(c, cls) (classes[(unsigned char)(c)] & (cls))
+
+//! It's valid only for comparison with a letter.
+#define lowered(c) ((c) | 0x20)
+//!@}
+
+
+/*!
+ * @name Keyword tables
+ * Both tables (for keywords and preprocessor keywords) are filled from
+ * the token maps using the same hash function, which has no collisions on
+ * them. Thus, the lookup is a hash and a single comparison.
  */
 //!@{
-struct extstr_s {
+#define WORDS_TABLE_SIZE 128
+
+struct word_s {
     const char *data;
     int len;
+    enum token_e kind;
 };
 
+static struct word_s keywords[WORDS_TABLE_SIZE];
+static struct word_s pp_keywords[WORDS_TABLE_SIZE];
+
 
-static int comparator(struct extstr_s *key, struct extstr_s *entry)
+static inline unsigned hash_word(const char *word, int len)
 {
-    int len = key->len > entry->len ? entry->len + 1
-            : key->len < entry->len ? key->len + 1
-                                    : key->len;
+    assert(len >= 2);
 
-    return memcmp(key->data, entry->data, len);
+    const unsigned char *w = (const unsigned char *)word;
+    return (w[0] + w[1] * 9 + w[len - 1] * 12 + len) % WORDS_TABLE_SIZE;
 }
 
 
-static inline enum token_e find_kw(const char *word, int len)
+static void add_word(struct word_s *table, enum token_e kind,
+                     const char *data, int len)
 {
-    static struct extstr_s table[] = {
-#define XX(kind, word) {word, sizeof(word)-1},
-        TOK_KW_MAP(XX)
-#undef XX
-    };
+    struct word_s *slot = &table[hash_word(data, len)];
 
-    static struct extstr_s key;
-    struct extstr_s *res;
+    // Not an assert, so builds w/o them can't lose keywords silently.
+    // Adjust `hash_word()` if it fails.
+    if (slot->data)
+    {
+        fprintf(stderr, "Keywords \"%s\" and \"%s\" collide.\n",
+                slot->data, data);
+        abort();
+    }
 
-    key.data = word;
-    key.len = len;
+    *slot = (struct word_s){data, len, kind};
+}
 
-    res = bsearch((void *)&key,
-        table, sizeof(table) / sizeof(*table), sizeof(*table),
-        (int (*)(const void *, const void *))comparator);
 
-    return res ? (res - table) + KW_BOOL : TOK_UNKNOWN;
+static void fill_word_tables(void)
+{
+    static bool filled = false;
+
+    if (filled)
+        return;
+
+    filled = true;
+
+#define XX(kind, word) add_word(keywords, kind, word, sizeof(word) - 1);
+    TOK_KW_MAP(XX)
+#undef XX
+
+#define XX(kind, word) add_word(pp_keywords, kind, word, sizeof(word) - 1);
+    TOK_PP_MAP(XX)
+#undef XX
 }
 
 
-static inline enum token_e find_pp(const char *word, int len)
+static inline enum token_e find_word(const struct word_s *table,
+                                     const char *word, int len)
 {
-    static struct extstr_s table[] = {
-#define XX(kind, word) {word, sizeof(word)-1},
-        TOK_PP_MAP(XX)
-#undef XX
-    };
+    const struct word_s *slot;
 
-    static struct extstr_s key;
-    struct extstr_s *res;
+    if (len < 2)
+        return TOK_UNKNOWN;
 
-    key.data = word;
-    key.len = len;
+    slot = &table[hash_word(word, len)];
 
-    res = bsearch((void *)&key,
-        table, sizeof(table) / sizeof(*table), sizeof(*table),
-        (int (*)(const void *, const void *))comparator);
+    if (slot->len == len && !memcmp(slot->data, word, len))
+        return slot->kind;
 
-    return res ? (res - table) + PP_DEFINE : TOK_UNKNOWN;
+    return TOK_UNKNOWN;
 }
 //!@}
 
@@ -129,6 +227,30 @@ static int is_nel(const char *c)
     return 0;
 }
 
+
+/*!
+ * Backslashes followed by a whitespace are the only places, where `eat()`
+ * does more than the simple increment. All of them are found in advance
+ * (using vectorized `strchr`), so the frequent case compares `ch` with the
+ * next such place instead of checking the following byte.
+ */
+static void find_splices(void)
+{
+    if (!splices)
+        splices = new_vec(char *, 64);
+
+    vec_len(splices) = 0;
+
+    // The first byte is never reached by `eat()`.
+    for (char *pos = g_data; (pos = strchr(pos, '\\')); ++pos)
+        if (pos != g_data && in_class(pos[1], C_SPACE))
+            vec_push(splices, pos);
+
+    vec_push(splices, NULL);
+    splice = splices;
+}
+
+
 static void eat(int num)
 {
     assert(num > 0);
@@ -144,7 +266,7 @@ static void eat(int num)
     }
 
     // Frequent case.
-    if (num == 1 && ch[1] != '\\')
+    if (num == 1 && ch + 1 != *splice)
     {
         ++ch;
         return;
@@ -156,12 +278,15 @@ static void eat(int num)
          * but it's sufficient for literals, macros and identifiers.
          * Therefore this cannot affect any real program.
          */
-        while (*++ch == '\\')
+        while (++ch == *splice)
         {
-            while (isspace(ch[1]) && !is_nel(ch + 1))
+            assert(*ch == '\\');
+            ++splice;
+
+            while (in_class(ch[1], C_SPACE) && !is_nel(ch + 1))
                 ++ch;
 
-            if (isspace(ch[1]))
+            if (in_class(ch[1], C_SPACE))
                 ++ch;
 
             if (!(nel = is_nel(ch)))
@@ -178,10 +303,216 @@ static void eat(int num)
 }
 
 
+/*!
+ * @name Fast scanners
+ * They look for the next byte that requires attention of `eat()`, so all
+ * bytes before it can be skipped by the simple increment. Newlines and
+ * backslashes are always stops, therefore `g_lines` is filled as before.
+ *
+ * Vector versions use aligned loads only, hence they never cross a page
+ * boundary and can't read beyond the terminating '\0' of `g_data`.
+ */
+//!@{
+
+//! Returns the first byte, which is neither space nor tab.
+static const char *skip_blanks_scalar(const char *s)
+{
+    while (*s == ' ' || *s == '\t')
+        ++s;
+
+    return s;
+}
+
+
+//! Returns the first byte, which is `quote`, backslash, newline or '\0'.
+static const char *find_special_scalar(const char *s, char quote)
+{
+    while (*s && *s != quote && *s != '\\' && *s != '\n' && *s != '\r')
+        ++s;
+
+    return s;
+}
+
+
+#ifdef LEXER_SIMD
+/*
+ * All `*_mask_*()` loads below read out of bounds deliberately: a block
+ * starts before `s` and the last one passes the terminating '\0'. Aligned
+ * blocks don't cross pages, so the extra bytes are mapped and masked out.
+ */
+#define ALIGN_DOWN(s, n) ((const char *)((uintptr_t)(s) & ~(uintptr_t)(n - 1)))
+
+static inline unsigned blank_mask_sse2(const char *base)
+{
+    __m128i v = _mm_load_si128((const __m128i *)base);
+    __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                 _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+
+    return ~(unsigned)_mm_movemask_epi8(blank) & 0xffff;
+}
+
+
+static inline unsigned special_mask_sse2(const char *base, __m128i quote)
+{
+    __m128i v = _mm_load_si128((const __m128i *)base);
+    __m128i res = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                     _mm_cmpeq_epi8(v, _mm_setzero_si128())),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\')),
+                     _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')))));
+
+    return _mm_movemask_epi8(res);
+}
+
+
+static const char *skip_blanks_sse2(const char *s)
+{
+    const char *base = ALIGN_DOWN(s, 16);
+    unsigned mask = blank_mask_sse2(base) >> (s - base);
+
+    if (mask)
+        return s + __builtin_ctz(mask);
+
+    while (!mask)
+        mask = blank_mask_sse2(base += 16);
+
+    return base + __builtin_ctz(mask);
+}
+
+
+static const char *find_special_sse2(const char *s, char quote)
+{
+    const char *base = ALIGN_DOWN(s, 16);
+    __m128i q = _mm_set1_epi8(quote);
+    unsigned mask = special_mask_sse2(base, q) >> (s - base);
+
+    if (mask)
+        return s + __builtin_ctz(mask);
+
+    while (!mask)
+        mask = special_mask_sse2(base += 16, q);
+
+    return base + __builtin_ctz(mask);
+}
+
+
+static inline __attribute__((target("avx2")))
+unsigned blank_mask_avx2(const char *base)
+{
+    __m256i v = _mm256_load_si256((const __m256i *)base);
+    __m256i blank = _mm256_or_si256(
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+
+    return ~(unsigned)_mm256_movemask_epi8(blank);
+}
+
+
+static inline __attribute__((target("avx2")))
+unsigned special_mask_avx2(const char *base, __m256i quote)
+{
+    __m256i v = _mm256_load_si256((const __m256i *)base);
+    __m256i res = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                        _mm256_cmpeq_epi8(v, _mm256_setzero_si256())),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')))));
+
+    return (unsigned)_mm256_movemask_epi8(res);
+}
+
+
+static __attribute__((target("avx2")))
+const char *skip_blanks_avx2(const char *s)
+{
+    const char *base = ALIGN_DOWN(s, 32);
+    unsigned mask = blank_mask_avx2(base) >> (s - base);
+
+    if (mask)
+        return s + __builtin_ctz(mask);
+
+    while (!mask)
+        mask = blank_mask_avx2(base += 32);
+
+    return base + __builtin_ctz(mask);
+}
+
+
+static __attribute__((target("avx2")))
+const char *find_special_avx2(const char *s, char quote)
+{
+    const char *base = ALIGN_DOWN(s, 32);
+    __m256i q = _mm256_set1_epi8(quote);
+    unsigned mask = special_mask_avx2(base, q) >> (s - base);
+
+    if (mask)
+        return s + __builtin_ctz(mask);
+
+    while (!mask)
+        mask = special_mask_avx2(base += 32, q);
+
+    return base + __builtin_ctz(mask);
+}
+
+#undef ALIGN_DOWN
+#endif  // LEXER_SIMD
+
+
+static const char *(*skip_blanks)(const char *s) = NULL;
+static const char *(*find_special)(const char *s, char quote) = NULL;
+
+
+static void choose_scanners(void)
+{
+    if (skip_blanks)
+        return;
+
+    skip_blanks = skip_blanks_scalar;
+    find_special = find_special_scalar;
+
+#ifdef LEXER_SIMD
+    skip_blanks = skip_blanks_sse2;
+    find_special = find_special_sse2;
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        skip_blanks = skip_blanks_avx2;
+        find_special = find_special_avx2;
+    }
+#endif
+}
+
+
+//! Returns the first byte, which isn't [a-zA-Z0-9_].
+static inline const char *skip_word(const char *s)
+{
+    while (in_class(*s, C_WORD))
+        ++s;
+
+    return s;
+}
+
+
+/*!
+ * Moves to `stop` as repeated `eat(1)` would do.
+ * There must be neither newlines nor backslashes in [ch, stop).
+ */
+static inline void eat_until(const char *stop)
+{
+    if (stop > ch + 1)
+        ch = (char *)stop - 1;
+
+    eat(1);
+}
+//!@}
+
+
 static inline void skip_spaces(void)
 {
-    while (isspace(*ch))
-        eat(1);
+    while (in_class(*ch, C_SPACE))
+        eat_until(skip_blanks(ch));
 }
 
 
@@ -209,15 +540,15 @@ static inline void skip_spaces(void)
 static bool numeric_const(token_t *token)
 {
     assert(token);
-    assert(isdigit(*ch) || *ch == '.');
+    assert(in_class(*ch, C_DIGIT) || *ch == '.');
 
     bool is_float = false;
 
-    while (isxdigit(*ch))
+    while (in_class(*ch, C_XDIGIT))
         eat(1);
-    if (tolower(*ch) == 'x')
+    if (lowered(*ch) == 'x')
         eat(1);
-    while (isxdigit(*ch))
+    while (in_class(*ch, C_XDIGIT))
         eat(1);
 
     if (*ch == '.')
@@ -226,20 +557,20 @@ static bool numeric_const(token_t *token)
         eat(1);
     }
 
-    while (isxdigit(*ch))
+    while (in_class(*ch, C_XDIGIT))
         eat(1);
-    if (tolower(*ch) == 'p')
+    if (lowered(*ch) == 'p')
         eat(1);
 
-    if (is_float && (tolower(ch[-1]) == 'e' || tolower(ch[-1]) == 'p'))
+    if (is_float && (lowered(ch[-1]) == 'e' || lowered(ch[-1]) == 'p'))
     {
         if (*ch == '+' || *ch == '-')
             eat(1);
-        while (isdigit(*ch))
+        while (in_class(*ch, C_DIGIT))
             eat(1);
     }
 
-    while (isalpha(*ch))
+    while (in_class(*ch, C_ALPHA))
         eat(1);
 
     token->kind = TOK_NUM_CONST;
@@ -257,12 +588,14 @@ static bool char_const(token_t *token)
 
     eat(*ch == 'L' ? 2 : 1);
     while (*ch && !is_nel(ch) && *ch != '\'')
-    {
         if (*ch == '\\')
+        {
             eat(1);
-        if (*ch)
-            eat(1);
-    }
+            if (*ch)
+                eat(1);
+        }
+        else
+            eat_until(find_special(ch, '\''));
 
     if (*ch != '\'')
         return error("Unexpected %s while parsing character constant",
@@ -285,12 +618,14 @@ static bool string_literal(token_t *token)
 
     eat(*ch == 'L' ? 2 : 1);
     while (*ch && !is_nel(ch) && *ch != '"')
-    {
         if (*ch == '\\')
+        {
             eat(1);
-        if (*ch)
-            eat(1);
-    }
+            if (*ch)
+                eat(1);
+        }
+        else
+            eat_until(find_special(ch, '"'));
 
     if (*ch != '"')
         return error("Unexpected %s while parsing string literal",
@@ -310,12 +645,12 @@ static bool check_ucn(void)
 {
     int digits;
 
-    if (!(*ch == '\\' && tolower(ch[1]) == 'u'))
+    if (!(*ch == '\\' && lowered(ch[1]) == 'u'))
         return false;
 
     digits = ch[1] == 'u' ? 4 : 8;
     for (int i = 0; i < digits; ++i)
-        if (!isxdigit(ch[i + 2]))
+        if (!in_class(ch[i + 2], C_XDIGIT))
             return false;
 
     return true;
@@ -334,17 +669,20 @@ static bool check_ucn(void)
 static bool identifier(token_t *token)
 {
     assert(token);
-    assert(isalpha(*ch) || *ch == '_' || check_ucn());
+    assert(in_class(*ch, C_ALPHA) || *ch == '_' || check_ucn());
 
     const char *start = ch;
 
     do
-        eat(*ch == '\\' ? (ch[1] == 'u' ? 6 : 10) : 1);
-    while (isalnum(*ch) || *ch == '_' || check_ucn());
+        if (*ch == '\\')
+            eat(ch[1] == 'u' ? 6 : 10);
+        else
+            eat_until(skip_word(ch));
+    while (in_class(*ch, C_WORD) || check_ucn());
 
     if (parsing_pp_directive)
     {
-        token->kind = find_pp(start, ch - start);
+        token->kind = find_word(pp_keywords, start, ch - start);
 
         if (token->kind == PP_INCLUDE)
             parsing_header_name = true;
@@ -353,10 +691,13 @@ static bool identifier(token_t *token)
     }
     else
     {
-        token->kind = find_kw(start, ch - start);
+        token->kind = find_word(keywords, start, ch - start);
 
         if (token->kind == TOK_UNKNOWN)
+        {
             token->kind = TOK_IDENTIFIER;
+            token->atom = intern(start, ch - start);
+        }
     }
 
     return true;
@@ -371,8 +712,8 @@ static bool punctuator(token_t *token)
     //#TODO: support for digraphs and trigraphs.
     assert(token);
 
-    static const char *puncts[] = {
-#define XX(kind, word) word,
+    static const unsigned char lengths[] = {
+#define XX(kind, word) sizeof(word) - 1,
     TOK_PN_MAP(XX)
 #undef XX
     };
@@ -452,7 +793,7 @@ static bool punctuator(token_t *token)
             assert(0);
     }
 
-    eat(strlen(puncts[kind - PN_LSQUARE]));
+    eat(lengths[kind - PN_LSQUARE]);
 
     token->kind = kind;
     return true;
@@ -467,7 +808,10 @@ static bool comment(token_t *token)
     assert(token);
     assert(*ch == '/' && (ch[1] == '*' || ch[1] == '/'));
 
+    const char *text, *end;
+
     eat(2);
+    text = ch;
 
     if (ch[-1] == '*')
     {
@@ -475,16 +819,28 @@ static bool comment(token_t *token)
             eat(1);
 
         while (*ch && !(ch[-1] == '*' && *ch == '/'))
-            eat(1);
+            eat_until(find_special(ch, '*'));
 
         if (!*ch)
             return error("Unexpected EOF while parsing comment");
 
         eat(1);
+        end = ch - 2;
     }
     else
+    {
         while (*ch && !is_nel(ch))
-            eat(1);
+            eat_until(find_special(ch, '\n'));
+
+        end = ch;
+    }
+
+    while (text < end && (*text == ' ' || *text == '\t'))
+        ++text;
+
+    // Suppressions of rules.
+    if (end - text > 6 && !memcmp(text, "clint-", 6))
+        add_suppression(vec_len(g_lines) - 1, token->start.column, text, end);
 
     token->kind = TOK_COMMENT;
     return true;
@@ -520,14 +876,18 @@ void pull_token(token_t *token)
 {
     assert(token);
 
-    bool success;
+    bool success, cut;
     skip_spaces();
 
     token->start.pos = ch;
     token->start.line = vec_len(g_lines) - 1;
     token->start.column = get_column(ch);
+    token->atom = 0;
 
-    switch (*ch)
+    // The rest of the file is cut off, once its time is out.
+    cut = timed_out();
+
+    switch (cut ? '\0' : *ch)
     {
         // EOF.
         case '\0':
@@ -580,7 +940,8 @@ void pull_token(token_t *token)
 
         // Numeric constant or punctuator.
         case '.':
-            success = (isdigit(ch[1]) ? numeric_const : punctuator)(token);
+            success = (in_class(ch[1], C_DIGIT) ? numeric_const
+                                                : punctuator)(token);
             break;
 
         case '[': case ']': case '(': case ')': case '{': case '}': case '&':
@@ -632,7 +993,7 @@ void pull_token(token_t *token)
             break;
     }
 
-    if (!*ch)
+    if (!*ch || cut)
         g_lines[vec_len(g_lines) - 1].length = get_column(ch);
 
     if (!success)
@@ -647,10 +1008,9 @@ void pull_token(token_t *token)
 void tokenize(void)
 {
     assert(g_lines && vec_len(g_lines) == 1);
-    assert(!g_tokens);
+    assert(g_tokens && vec_len(g_tokens) == 0);
 
     token_t token;
-    g_tokens = new_vec(token_t, 4096);
 
     do
     {
@@ -659,3 +1019,93 @@ void tokenize(void)
     }
     while (token.kind != TOK_EOF);
 }
+
+
+//////////////////////
+// Opt-out markers. //
+//////////////////////
+
+static bool contains(const char *from, const char *to, const char *marker)
+{
+    size_t len = strlen(marker);
+
+    for (; from + len <= to; ++from)
+        if (!memcmp(from, marker, len))
+            return true;
+
+    return false;
+}
+
+
+//! Escaped quotes don't end literals, newlines end broken ones.
+static const char *skip_literal(const char *pos, const char *end)
+{
+    char quote = *pos;
+
+    for (++pos; pos < end && *pos != quote && *pos != '\n'; ++pos)
+        if (*pos == '\\')
+            ++pos;
+
+    return pos + 1;
+}
+
+
+//! A comment cut off by `end` is searched till `end`.
+static const char *end_of_comment(const char *text, const char *end,
+                                  bool line)
+{
+    const char *to = text;
+
+    if (!line)
+    {
+        while (to < end && !(to + 1 < end && to[0] == '*' && to[1] == '/'))
+            ++to;
+
+        return to;
+    }
+
+    // Splices continue line comments.
+    for (; to < end && *to != '\n'; ++to)
+        if (*to == '\\')
+            ++to;
+
+    return to < end ? to : end;
+}
+
+
+/*!
+ * Checks whether any of `markers` is mentioned in comments among the first
+ * `size` bytes of `data`, which aren't lexed yet. Literals and code are
+ * skipped, so they can contain markers (e.g. defaults of clint itself).
+ */
+bool has_marker(const char *data, size_t size, const char **markers)
+{
+    const char *pos = data, *end = data + size;
+
+    while (pos < end)
+    {
+        const char *text = pos + 2, *to;
+
+        if (*pos == '"' || *pos == '\'')
+        {
+            pos = skip_literal(pos, end);
+            continue;
+        }
+
+        if (*pos != '/' || text > end || (pos[1] != '/' && pos[1] != '*'))
+        {
+            ++pos;
+            continue;
+        }
+
+        to = end_of_comment(text, end, pos[1] == '/');
+
+        for (const char **marker = markers; *marker; ++marker)
+            if (contains(text, to, *marker))
+                return true;
+
+        pos = to + 2;
+    }
+
+    return false;
+}
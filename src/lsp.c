@@ -0,0 +1,728 @@
+/*!
+ * @brief It serves the language server protocol for editors.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#include <json.h>
+
+#include "clint.h"
+
+
+//! Checks wait for a pause in messages, so bursts of edits are checked once.
+#define DEBOUNCE_MS 5
+
+/*!
+ * Open documents of the editor. Text is UTF-8, but positions of the protocol
+ * count UTF-16 units.
+ */
+static struct document_s {
+    char *uri;
+    char *path;
+    char *text;
+    size_t len;
+    int64_t version;
+    bool dirty;
+} **documents = NULL;
+
+//! The document, whose tree is the state, so its changes are checked only.
+static struct document_s *loaded = NULL;
+
+static bool shutting_down = false;
+
+//! Configures rules for a document of `serve_lsp()`.
+static preparer_t prepare = NULL;
+
+//! The document being checked, its check is interrupted once it's `stale`.
+static struct document_s *checking = NULL;
+static bool stale = false;
+static size_t scanned = 0;      //!< Pending input peeked during the check.
+
+//! Messages are read w/o stdio, so pending input is seen by `poll()`.
+static struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} input;
+
+//! The body of the message to send.
+static struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} output;
+
+
+static bool read_input(void)
+{
+    ssize_t res;
+
+    if (input.capacity - input.len < 4096)
+    {
+        input.capacity = input.capacity ? input.capacity * 2 : 1 << 16;
+        input.data = xrealloc(input.data, input.capacity);
+    }
+
+    do
+        res = read(STDIN_FILENO, input.data + input.len,
+                   input.capacity - input.len);
+    while (res < 0 && errno == EINTR);
+
+    if (res <= 0)
+        return false;
+
+    input.len += res;
+    return true;
+}
+
+
+static bool wait_input(int timeout)
+{
+    struct pollfd fd = {STDIN_FILENO, POLLIN, 0};
+    return poll(&fd, 1, timeout) != 0;
+}
+
+
+//! Parses the value of the "Content-Length" header.
+static size_t content_length(const char *value)
+{
+    size_t length = 0;
+
+    for (; *value == ' ' || isdigit(*value); ++value)
+        if (*value != ' ')
+            length = length * 10 + (*value - '0');
+
+    return length;
+}
+
+
+/*!
+ * Finds the body of the message at `from` in `input`, if it's complete.
+ * Returns its length and sets `size` to the size of the message with headers.
+ */
+static char *next_message(size_t from, size_t *length, size_t *size)
+{
+    size_t start = from;
+    const char *line = input.data + from;
+
+    *length = 0;
+
+    while (start + 4 <= input.len && memcmp(input.data + start, "\r\n\r\n", 4))
+        ++start;
+
+    if (start + 4 > input.len)
+        return NULL;
+
+    while (line < input.data + start)
+    {
+        if (!strncasecmp(line, "Content-Length:", 15))
+            *length = content_length(line + 15);
+
+        while (line < input.data + start && *line != '\n')
+            ++line;
+
+        ++line;
+    }
+
+    start += 4;
+
+    if (input.len - start < *length)
+        return NULL;
+
+    *size = start + *length - from;
+    return input.data + start;
+}
+
+
+static void reserve_output(size_t size)
+{
+    if (output.len + size + 1 <= output.capacity)
+        return;
+
+    while (output.len + size + 1 > output.capacity)
+        output.capacity = output.capacity ? output.capacity * 2 : 4096;
+
+    output.data = xrealloc(output.data, output.capacity);
+}
+
+
+static void emit(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void emit(const char *fmt, ...)
+{
+    va_list arg;
+    int len;
+
+    va_start(arg, fmt);
+    len = vsnprintf(NULL, 0, fmt, arg);
+    va_end(arg);
+
+    reserve_output(len);
+
+    va_start(arg, fmt);
+    vsnprintf(output.data + output.len, len + 1, fmt, arg);
+    va_end(arg);
+
+    output.len += len;
+}
+
+
+static void emit_string(const char *str)
+{
+    // Escapes take up to 6 chars, so plain chars are written w/o checks.
+    reserve_output(strlen(str) * 6 + 2);
+    output.data[output.len++] = '"';
+
+    for (; *str; ++str)
+    {
+        unsigned char ch = *str;
+
+        if (ch == '"' || ch == '\\')
+            emit("\\%c", ch);
+        else if (ch == '\n')
+            emit("\\n");
+        else if (ch == '\t')
+            emit("\\t");
+        else if (ch < 0x20 || ch == 0x7f)
+            emit("\\u%04x", ch);
+        else
+            output.data[output.len++] = ch;
+    }
+
+    output.data[output.len++] = '"';
+}
+
+
+static void send_message(void)
+{
+    printf("Content-Length: %zu\r\n\r\n", output.len);
+    fwrite(output.data, 1, output.len, stdout);
+    fflush(stdout);
+
+    output.len = 0;
+}
+
+
+//! Responds to the request `id` with the member "result" or "error".
+static void respond(json_value *id, const char *member)
+{
+    emit("{\"jsonrpc\": \"2.0\", \"id\": ");
+
+    if (has_type(id, integer))
+        emit("%" PRId64, (int64_t)id->u.integer);
+    else if (has_type(id, string))
+        emit_string(id->u.string.ptr);
+    else
+        emit("null");
+
+    emit(", %s}", member);
+    send_message();
+}
+
+
+//! Converts the column in bytes to UTF-16 units.
+static unsigned utf16_column(unsigned line, unsigned column)
+{
+    unsigned units = 0, length;
+    const char *start;
+
+    if (line >= vec_len(g_lines))
+        return column;
+
+    start = g_lines[line].start;
+    length = g_lines[line].length;
+
+    for (unsigned i = 0; i < column && i < length; ++i)
+        if ((start[i] & 0xc0) != 0x80)
+            units += (unsigned char)start[i] >= 0xf0 ? 2 : 1;
+
+    return units + (column > length ? column - length : 0);
+}
+
+
+//! Errors point to starts of tokens, then the token is the range.
+static token_t *find_token_at(unsigned line, unsigned column)
+{
+    toknum_t lo = 1, hi = vec_len(g_tokens);
+
+    while (lo < hi)
+    {
+        toknum_t mid = lo + (hi - lo) / 2;
+        location_t *start = &g_tokens[mid].start;
+
+        if (start->line < line ||
+            (start->line == line && start->column < column))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo < vec_len(g_tokens) && g_tokens[lo].start.line == line &&
+        g_tokens[lo].start.column == column)
+        return &g_tokens[lo];
+
+    return NULL;
+}
+
+
+static void emit_diagnostic(error_t *error)
+{
+    token_t *token = find_token_at(error->line, error->column);
+    unsigned end_line = token ? token->end.line : error->line;
+    unsigned end_column = token ? token->end.column + 1 : error->column + 1;
+
+    emit("{\"range\": {\"start\": {\"line\": %u, \"character\": %u}, "
+         "\"end\": {\"line\": %u, \"character\": %u}}, \"severity\": %d, "
+         "\"source\": \"clint\", ", error->line,
+         utf16_column(error->line, error->column), end_line,
+         utf16_column(end_line, end_column), error->stylistic ? 2 : 1);
+
+    if (error->rule)
+    {
+        emit("\"code\": ");
+        emit_string(error->rule);
+        emit(", ");
+    }
+
+    emit("\"message\": ");
+    emit_string(error->message);
+    emit("}");
+}
+
+
+//! Publishes errors of the loaded document, `NULL` clears diagnostics.
+static void publish_diagnostics(struct document_s *doc, error_t *errors)
+{
+    emit("{\"jsonrpc\": \"2.0\", "
+         "\"method\": \"textDocument/publishDiagnostics\", \"params\": "
+         "{\"uri\": ");
+    emit_string(doc->uri);
+    emit(", \"version\": %" PRId64 ", \"diagnostics\": [", doc->version);
+
+    for (unsigned i = 0; errors && i < vec_len(errors); ++i)
+    {
+        if (i)
+            emit(", ");
+
+        emit_diagnostic(&errors[i]);
+    }
+
+    emit("]}}");
+    send_message();
+}
+
+
+static void check_document(struct document_s *doc)
+{
+    char *data = xmalloc(doc->len + 1);
+
+    memcpy(data, doc->text, doc->len + 1);
+    doc->dirty = false;
+
+    // Diagnostics are cleared, the state is kept for the next changes.
+    if (!prepare(doc->path, data, doc->len))
+    {
+        free(data);
+        publish_diagnostics(doc, NULL);
+        return;
+    }
+
+    // It stops the timer too.
+    if (loaded != doc)
+        reset_state();
+
+    checking = doc;
+    stale = false;
+    scanned = 0;
+    start_timer();
+
+    if (loaded == doc)
+        check_changes(data);
+    else
+    {
+        g_filename = xstrdup(doc->path);
+        g_data = data;
+        init_parser();
+        parse();
+        check_rules();
+
+        loaded = doc;
+    }
+
+    checking = NULL;
+
+    if (!timed_out())
+    {
+        publish_diagnostics(doc, g_errors);
+        return;
+    }
+
+    // Diagnostics of the outdated version are dropped, the next one is checked.
+    if (!stale)
+    {
+        token_t *last = &g_tokens[vec_len(g_tokens) - 1];
+
+        add_warn_at(last->start, "Checking timed out after %u ms, "
+                    "the rest of the file is skipped", g_file_timeout);
+        publish_diagnostics(doc, g_errors);
+    }
+
+    // The tree is cut off, so changes cannot continue it.
+    reset_state();
+    loaded = NULL;
+}
+
+
+static struct document_s *find_document(json_value *params)
+{
+    json_value *text_doc = find_field(params, "textDocument"), *uri;
+
+    if (!text_doc || !has_type(uri = find_field(text_doc, "uri"), string))
+        return NULL;
+
+    for (unsigned i = 0; i < vec_len(documents); ++i)
+        if (!strcmp(documents[i]->uri, uri->u.string.ptr))
+            return documents[i];
+
+    return NULL;
+}
+
+
+//! Paths of "file://" URIs are decoded, other URIs are used as is.
+static char *uri_to_path(const char *uri)
+{
+    char *path, *out;
+
+    if (strncmp(uri, "file://", 7))
+        return xstrdup(uri);
+
+    out = path = xmalloc(strlen(uri) + 1);
+
+    for (uri += 7; *uri; ++out)
+        if (uri[0] == '%' && isxdigit(uri[1]) && isxdigit(uri[2]))
+        {
+            char hex[3] = {uri[1], uri[2], '\0'};
+            *out = (char)strtol(hex, NULL, 16);
+            uri += 3;
+        }
+        else
+            *out = *uri++;
+
+    *out = '\0';
+    return path;
+}
+
+
+static void open_document(json_value *params)
+{
+    json_value *text_doc = find_field(params, "textDocument"),
+               *uri = text_doc ? find_field(text_doc, "uri") : NULL,
+               *text = text_doc ? find_field(text_doc, "text") : NULL,
+               *version = text_doc ? find_field(text_doc, "version") : NULL;
+    struct document_s *doc = find_document(params);
+
+    if (!has_type(uri, string) || !has_type(text, string))
+        return;
+
+    if (!doc)
+    {
+        doc = xcalloc(1, sizeof(*doc));
+        doc->uri = xstrdup(uri->u.string.ptr);
+        doc->path = uri_to_path(doc->uri);
+        vec_push(documents, doc);
+    }
+    else if (loaded == doc)
+        loaded = NULL;
+
+    free(doc->text);
+    doc->text = xmalloc(text->u.string.length + 1);
+    memcpy(doc->text, text->u.string.ptr, text->u.string.length + 1);
+    doc->len = text->u.string.length;
+    doc->version = has_type(version, integer) ? version->u.integer : 0;
+    doc->dirty = true;
+}
+
+
+//! Converts the position to the offset in the text of `doc`.
+static size_t offset_at(struct document_s *doc, json_value *position)
+{
+    json_value *line = find_field(position, "line"),
+               *character = find_field(position, "character");
+    size_t offset = 0;
+
+    if (!has_type(line, integer) || !has_type(character, integer))
+        return (size_t)-1;
+
+    for (json_int_t i = 0; i < line->u.integer; ++i)
+    {
+        char *newline = memchr(doc->text + offset, '\n', doc->len - offset);
+
+        if (!newline)
+            return doc->len;
+
+        offset = newline + 1 - doc->text;
+    }
+
+    for (json_int_t units = 0; units < character->u.integer &&
+         offset < doc->len && doc->text[offset] != '\n';)
+    {
+        unsigned char ch = doc->text[offset];
+
+        units += ch >= 0xf0 ? 2 : 1;
+        offset += ch >= 0xf0 ? 4 : ch >= 0xe0 ? 3 : ch >= 0xc0 ? 2 : 1;
+    }
+
+    return offset < doc->len ? offset : doc->len;
+}
+
+
+static bool apply_change(struct document_s *doc, json_value *change)
+{
+    json_value *range = find_field(change, "range"),
+               *text = find_field(change, "text");
+    size_t from = 0, to = doc->len, len;
+
+    if (!has_type(text, string))
+        return false;
+
+    if (range)
+    {
+        if (range->type != json_object)
+            return false;
+
+        from = offset_at(doc, find_field(range, "start"));
+        to = offset_at(doc, find_field(range, "end"));
+
+        if (from > to || to > doc->len)
+            return false;
+    }
+
+    len = text->u.string.length;
+
+    if (len > to - from)
+        doc->text = xrealloc(doc->text, doc->len + len - (to - from) + 1);
+
+    memmove(doc->text + from + len, doc->text + to, doc->len - to + 1);
+    memcpy(doc->text + from, text->u.string.ptr, len);
+    doc->len += len - (to - from);
+
+    return true;
+}
+
+
+static void change_document(json_value *params)
+{
+    struct document_s *doc = find_document(params);
+    json_value *changes = find_field(params, "contentChanges"), *version;
+
+    if (!doc || !has_type(changes, array))
+        return;
+
+    for (unsigned i = 0; i < changes->u.array.length; ++i)
+        if (!has_type(changes->u.array.values[i], object) ||
+            !apply_change(doc, changes->u.array.values[i]))
+        {
+            fprintf(stderr, "%s: Invalid change.\n", doc->uri);
+            break;
+        }
+
+    version = find_field(find_field(params, "textDocument"), "version");
+    doc->version = has_type(version, integer) ? version->u.integer : 0;
+    doc->dirty = true;
+}
+
+
+static void close_document(json_value *params)
+{
+    struct document_s *doc = find_document(params);
+    unsigned i = 0;
+
+    if (!doc)
+        return;
+
+    if (loaded == doc)
+    {
+        reset_state();
+        loaded = NULL;
+    }
+
+    publish_diagnostics(doc, NULL);
+
+    while (documents[i] != doc)
+        ++i;
+
+    documents[i] = documents[vec_len(documents) - 1];
+    --vec_len(documents);
+
+    free(doc->uri);
+    free(doc->path);
+    free(doc->text);
+    free(doc);
+}
+
+
+//! Handles the message, returns false on the exit.
+static bool handle_message(json_value *message)
+{
+    json_value *method = find_field(message, "method"),
+               *id = find_field(message, "id"),
+               *params = find_field(message, "params");
+    const char *name;
+
+    // Responses of the client aren't expected.
+    if (!has_type(method, string))
+        return true;
+
+    name = method->u.string.ptr;
+
+    if (!has_type(params, object))
+        params = NULL;
+
+    if (!strcmp(name, "initialize"))
+        respond(id, "\"result\": {\"capabilities\": {\"textDocumentSync\": "
+                    "{\"openClose\": true, \"change\": 2}}, \"serverInfo\": "
+                    "{\"name\": \"clint\", \"version\": \"" VERSION "\"}}");
+    else if (!strcmp(name, "shutdown"))
+    {
+        shutting_down = true;
+        respond(id, "\"result\": null");
+    }
+    else if (!strcmp(name, "exit"))
+        return false;
+    else if (!params)
+    {
+        if (id)
+            respond(id, "\"error\": {\"code\": -32602, "
+                        "\"message\": \"Invalid params\"}");
+    }
+    else if (!strcmp(name, "textDocument/didOpen"))
+        open_document(params);
+    else if (!strcmp(name, "textDocument/didChange"))
+        change_document(params);
+    else if (!strcmp(name, "textDocument/didClose"))
+        close_document(params);
+    else if (id)
+        respond(id, "\"error\": {\"code\": -32601, "
+                    "\"message\": \"Method not found\"}");
+
+    return true;
+}
+
+
+/*!
+ * Polled by `timed_out()` during checks: pending messages are read, but only
+ * peeked, so the check is interrupted once the checked document is changed
+ * or closed. Messages are handled after the check.
+ */
+static bool is_stale(void)
+{
+    size_t length, size;
+    char *body;
+
+    if (!wait_input(0) || !read_input())
+        return false;
+
+    while (!stale && (body = next_message(scanned, &length, &size)))
+    {
+        json_value *message = json_parse(body, length),
+                   *method = find_field(message, "method");
+
+        stale = has_type(method, string) &&
+                (!strcmp(method->u.string.ptr, "textDocument/didChange") ||
+                 !strcmp(method->u.string.ptr, "textDocument/didClose")) &&
+                find_document(find_field(message, "params")) == checking;
+
+        if (message)
+            json_value_free(message);
+
+        scanned += size;
+    }
+
+    return stale;
+}
+
+
+//! Checks changed documents, unless a message comes during the debounce.
+static bool check_dirty_documents(void)
+{
+    bool dirty = false;
+
+    for (unsigned i = 0; i < vec_len(documents); ++i)
+        dirty = dirty || documents[i]->dirty;
+
+    if (!dirty || wait_input(DEBOUNCE_MS))
+        return false;
+
+    for (unsigned i = 0; i < vec_len(documents); ++i)
+        if (documents[i]->dirty)
+            check_document(documents[i]);
+
+    return true;
+}
+
+
+/*!
+ * Serves the language server protocol over stdio. The state of the parser
+ * is global, so checks are run between messages instead of a background
+ * thread: pending messages supersede checks of changed documents, which
+ * wait for a pause of `DEBOUNCE_MS`, and the check of a document is
+ * interrupted by `timed_out()` once it's changed again. Changes of the loaded
+ * document are checked incrementally by `check_changes()`. Before every
+ * check, `preparer` configures rules for the document or returns false to
+ * skip it.
+ */
+int serve_lsp(preparer_t preparer)
+{
+    prepare = preparer;
+    g_log_mode |= LOG_SILENCE;
+
+    // `check_changes()` continues the serial parser.
+    g_jobs = 1;
+    g_pipelined = false;
+    g_interrupter = is_stale;
+
+    documents = new_vec(struct document_s *, 8);
+
+    for (;;)
+    {
+        size_t length, size;
+        char *body = next_message(0, &length, &size);
+
+        if (body)
+        {
+            json_value *message = json_parse(body, length);
+            bool running = !message || handle_message(message);
+
+            if (message)
+                json_value_free(message);
+            else
+                fprintf(stderr, "Invalid message.\n");
+
+            input.len -= size;
+            memmove(input.data, input.data + size, input.len);
+
+            if (!running)
+                break;
+
+            continue;
+        }
+
+        if (check_dirty_documents())
+            continue;
+
+        if (!read_input())
+            break;
+    }
+
+    // As the protocol requires.
+    return shutting_down ? 0 : 1;
+}
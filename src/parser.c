@@ -3,6 +3,8 @@
  */
 
 #include <assert.h>
+#include <pthread.h>
+#include <sched.h>
 #include <setjmp.h>
 #include <stdbool.h>
 #include <stdlib.h>
@@ -17,10 +19,29 @@
 //#TODO: GC for vectors.
 //#TODO: complete support for attributes.
 
-static toknum_t current;
-static bool allow_eof;
+// State of parsing is per thread because of the parallel mode.
+static __thread toknum_t current;
+static __thread toknum_t limit;
+static __thread bool allow_eof;
+static __thread bool failed;
+static bool pipelining;
+static bool by_parts;
 
-#define error(toknum, ...) add_error_at(g_tokens[toknum].start, __VA_ARGS__)
+//! Tokens released by parts before `g_tokens`.
+static toknum_t released;
+
+#define PART_SIZE 4096
+
+//! Tokens pulled ahead of the parser (see `prefetch_lines()`).
+static struct ahead_s {
+    token_t token;
+    bool known;
+} *ahead;
+
+static unsigned ahead_head;
+
+#define error(toknum, ...)                                                     \
+    (failed = true, add_error_at(g_tokens[toknum].start, __VA_ARGS__))
 #define panic(...) (error(current, __VA_ARGS__), recover_last())
 
 
@@ -28,16 +49,41 @@ static bool allow_eof;
 // Recovery mode. //
 ////////////////////
 
-static jmp_buf *recpoints;
+//! Nesting of productions, which is limited by `g_max_depth`.
+static __thread unsigned level = 0;
 
-#define foothold(idx) process_orphans(setjmp(recpoints[idx]) == 0)
-#define recover(idx) longjmp(recpoints[idx], 1)
+/*!
+ * Right-recursive chains (e.g. `a = b = c` or `case 1: case 2:`) are parsed
+ * in loops, their links wait here to be finished from the innermost one.
+ */
+static __thread struct link_s {
+    toknum_t st;
+    toknum_t op;
+    tree_t left;
+    tree_t middle;
+} *links;
+
+//! Jumps restore the nesting of the point.
+static __thread struct recpoint_s {
+    jmp_buf env;
+    unsigned level;
+    size_t links;
+} *recpoints;
+
+__thread unsigned g_recoveries = 0;
+
+#define foothold(idx) process_orphans(setjmp(recpoints[idx].env) == 0)
+#define recover(idx)                                                          \
+    (level = recpoints[idx].level, vec_len(links) = recpoints[idx].links,     \
+     longjmp(recpoints[idx].env, 1))
 #define recover_last() recover(vec_len(recpoints) - 1)
 
 
 static int push_recpoint(void)
 {
     vec_expand_if_need((void **)&recpoints);
+    recpoints[vec_len(recpoints)].level = level;
+    recpoints[vec_len(recpoints)].links = vec_len(links);
     return vec_len(recpoints)++;
 }
 
@@ -48,7 +94,8 @@ static void pop_recpoint(void)
 }
 
 
-static struct {
+
+static __thread struct {
     tree_t *trees;
     void **vectors;
 } orphans = {NULL, NULL};
@@ -73,6 +120,137 @@ static bool process_orphans(bool success)
 }
 
 
+////////////////////
+// Typedef names. //
+////////////////////
+
+enum {SYM_NONE, SYM_TYPEDEF, SYM_OBJECT};
+
+//! Maps atoms to the kind of the visible declaration.
+static __thread atom_t *symbols;
+
+//! Previous kinds to restore on leaving scopes.
+static __thread struct binding_s {
+    atom_t atom;
+    atom_t prev;
+} *bindings;
+
+//! Lengths of `bindings` on entering block scopes.
+static __thread unsigned *scopes;
+
+//! Names of members belong to their own namespace.
+static __thread bool in_members;
+
+//! Names of outer chunks assumed by workers of parallel mode.
+static __thread atom_t *inherited;
+
+//! Kinds of names which don't belong to the chunk, as they were looked up.
+static __thread struct assumption_s {
+    atom_t atom;
+    atom_t kind;
+} *assumptions;
+
+
+static unsigned enter_scope(void)
+{
+    vec_push(scopes, vec_len(bindings));
+    return vec_len(scopes);
+}
+
+
+//! Leaves the scope `depth` and all nested ones. The file scope is 0.
+static void leave_scope(unsigned depth)
+{
+    unsigned mark;
+
+    if (depth > vec_len(scopes))
+        return;
+
+    mark = depth ? scopes[depth - 1] : 0;
+
+    while (vec_len(bindings) > mark)
+    {
+        struct binding_s binding = vec_pop(bindings);
+        symbols[binding.atom] = binding.prev;
+    }
+
+    vec_len(scopes) = depth ? depth - 1 : 0;
+}
+
+
+static atom_t lookup(atom_t atom)
+{
+    atom_t kind = atom_map_get(symbols, atom);
+
+    if (kind == SYM_NONE && assumptions)
+    {
+        kind = atom_map_get(inherited, atom);
+        vec_push(assumptions, ((struct assumption_s){atom, kind}));
+    }
+
+    return kind;
+}
+
+
+static void bind(atom_t atom, atom_t kind)
+{
+    vec_push(bindings, ((struct binding_s){atom,
+                                           atom_map_get(symbols, atom)}));
+    atom_map_put(&symbols, atom, kind);
+}
+
+
+/*!
+ * Typedef names become known. Other names are recorded only if they hide
+ * typedef names.
+ */
+static void bind_declaration(tree_t specs, tree_t *decls)
+{
+    bool is_typedef = specs &&
+        g_tokens[((struct specifiers_s *)specs)->storage].kind == KW_TYPEDEF;
+
+    if (in_members)
+        return;
+
+    for (unsigned i = 0; i < vec_len(decls); ++i)
+    {
+        toknum_t name = ((struct declarator_s *)decls[i])->name;
+        atom_t atom = g_tokens[name].atom;
+
+        if (!name || !atom)
+            continue;
+
+        if (is_typedef)
+            bind(atom, SYM_TYPEDEF);
+        else if (lookup(atom) == SYM_TYPEDEF)
+            bind(atom, SYM_OBJECT);
+    }
+}
+
+
+//! Names of parameters hide typedef names in the body of the function.
+static void bind_parameters(tree_t *params)
+{
+    for (unsigned i = 0; i < vec_len(params); ++i)
+    {
+        struct declarator_s *decl;
+        atom_t atom;
+
+        // Ellipsis.
+        if (params[i]->type != PARAMETER)
+            continue;
+
+        decl = (struct declarator_s *)((struct parameter_s *)params[i])->decl;
+        if (!decl || !decl->name)
+            continue;
+
+        atom = g_tokens[decl->name].atom;
+        if (lookup(atom) == SYM_TYPEDEF)
+            bind(atom, SYM_OBJECT);
+    }
+}
+
+
 ///////////////////////
 // Common functions. //
 ///////////////////////
@@ -83,19 +261,196 @@ void init_parser(void)
 
     if (!recpoints)
     {
-        recpoints = new_vec(jmp_buf, 1);
+        recpoints = new_vec(struct recpoint_s, 1);
+        links = new_vec(struct link_s, 16);
         orphans.trees = new_vec(tree_t, 50);
         orphans.vectors = new_vec(void *, 15);
     }
 
     process_orphans(true);
     vec_len(recpoints) = 0;
+    vec_len(links) = 0;
+    level = 0;
+
+    if (!bindings)
+    {
+        bindings = new_vec(struct binding_s, 64);
+        scopes = new_vec(unsigned, 16);
+    }
+
+    leave_scope(0);
+    in_members = false;
+
+    if (!ahead)
+        ahead = new_vec(struct ahead_s, 64);
+
+    vec_len(ahead) = ahead_head = 0;
 
     init_lexer();
-    g_tokens = new_vec(token_t, 4096);
     memset(g_tokens, 0, sizeof(token_t));
     ++vec_len(g_tokens);  // 1-indexed.
     current = 1;
+    released = 0;
+    limit = (toknum_t)-1;
+    failed = false;
+}
+
+
+/*!
+ * Pulls the next token the parser is interested in: preprocessor lines and
+ * comments are skipped. Returns false if the token is unknown.
+ */
+static bool pull_significant(token_t *token)
+{
+    do
+    {
+        pull_token(token);
+
+        if (token->kind == TOK_UNKNOWN)
+            return false;
+
+        // Skip preprocessor.
+        while (token->kind == PN_HASH)
+        {
+            unsigned line = token->start.line;
+            do
+                pull_token(token);
+            while (token->kind != TOK_EOF &&
+                   (token->start.line == line ||
+                    g_lines[token->start.line - 1].dangling));
+        }
+    }
+    while (token->kind == TOK_COMMENT);
+
+    return true;
+}
+
+
+/////////////////////
+// Pipelined mode. //
+/////////////////////
+
+bool g_pipelined = false;
+
+#define RING_SIZE 1024
+
+/*!
+ * The lexer thread pulls tokens into the ring, the parser takes them out.
+ * Logs of the lexer are collected per token and replayed by the parser, so
+ * the order of errors is the same as in the serial mode.
+ */
+static struct {
+    struct slot_s {
+        token_t token;
+        bool known;
+        error_t *logs;
+    } slots[RING_SIZE];
+
+    unsigned head;
+    unsigned tail;
+    bool finished;
+    pthread_t thread;
+} ring;
+
+#define load(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define store(var, val) __atomic_store_n(&(var), val, __ATOMIC_RELEASE)
+
+
+static void *produce_tokens(void *unused)
+{
+    struct slot_s *slot;
+    error_t *logs = NULL;
+
+    collect_logs(&logs);
+
+    do
+    {
+        while (ring.tail - load(ring.head) == RING_SIZE)
+            sched_yield();
+
+        slot = &ring.slots[ring.tail % RING_SIZE];
+        slot->known = pull_significant(&slot->token);
+        slot->logs = logs;
+        logs = NULL;
+
+        store(ring.tail, ring.tail + 1);
+    }
+    while (slot->token.kind != TOK_EOF);
+
+    collect_logs(NULL);
+    return NULL;
+}
+
+
+static void start_pipeline(void)
+{
+    ring.head = ring.tail = 0;
+    ring.finished = false;
+
+    if (pthread_create(&ring.thread, NULL, produce_tokens, NULL))
+        abort();
+}
+
+
+static void stop_pipeline(void)
+{
+    pthread_join(ring.thread, NULL);
+}
+
+
+static bool take_token(token_t *token)
+{
+    struct slot_s *slot;
+
+    // The lexer keeps returning EOF at the end of the file.
+    if (ring.finished)
+    {
+        *token = ring.slots[(ring.head - 1) % RING_SIZE].token;
+        return true;
+    }
+
+    while (load(ring.tail) == ring.head)
+        sched_yield();
+
+    slot = &ring.slots[ring.head % RING_SIZE];
+    *token = slot->token;
+    replay_logs(slot->logs);
+    ring.finished = token->kind == TOK_EOF;
+
+    store(ring.head, ring.head + 1);
+    return slot->known;
+}
+
+
+static bool next_token(token_t *token)
+{
+    if (ahead_head < vec_len(ahead))
+    {
+        struct ahead_s *item = &ahead[ahead_head++];
+
+        if (ahead_head == vec_len(ahead))
+            ahead_head = vec_len(ahead) = 0;
+
+        *token = item->token;
+        return item->known;
+    }
+
+    return pipelining ? take_token(token) : pull_significant(token);
+}
+
+
+static enum token_e reach_eof(toknum_t eof)
+{
+    if (!allow_eof)
+    {
+        // The file is cut off by the timeout, it isn't a syntax error.
+        if (!timed_out())
+            error(eof, "Unexpected EOF");
+
+        recover(0);
+    }
+
+    return TOK_EOF;
 }
 
 
@@ -103,39 +458,27 @@ static enum token_e peek(unsigned lookahead)
 {
     unsigned required = current + lookahead;
 
+    // Workers of parallel mode see the end of their chunks as EOF.
+    if (required > limit)
+        return reach_eof(limit - 1);
+
     while (vec_len(g_tokens) < required)
     {
         token_t token;
-        pull_token(&token);
 
-        if (token.kind == TOK_UNKNOWN)
+        if (!next_token(&token))
             recover_last();
 
-        // Skip preprocessor.
-        while (token.kind == PN_HASH)
-        {
-            unsigned line = token.start.line;
-            do
-                pull_token(&token);
-            while (token.kind != TOK_EOF &&
-                   (token.start.line == line ||
-                    g_lines[token.start.line - 1].dangling));
-        }
-
-        // Skip comments.
-        if (token.kind != TOK_COMMENT)
-            vec_push(g_tokens, token);
+        vec_push(g_tokens, token);
 
         if (token.kind == TOK_EOF)
-            if (allow_eof)
-                return TOK_EOF;
-            else
-            {
-                error(vec_len(g_tokens) - 1, "Unexpected EOF");
-                recover(0);
-            }
+            return reach_eof(vec_len(g_tokens) - 1);
     }
 
+    // Tokens lexed ahead (see `lex_ahead()`) end with EOF as well.
+    if (g_tokens[required - 1].kind == TOK_EOF)
+        return reach_eof(required - 1);
+
     return g_tokens[required - 1].kind;
 }
 
@@ -190,6 +533,159 @@ static toknum_t expect_word(void)
 }
 
 
+//! Brackets which are opened, but not closed yet.
+struct nesting_s {
+    unsigned parens;
+    unsigned braces;
+};
+
+
+static void nest(struct nesting_s *nesting, enum token_e kind)
+{
+    switch (kind)
+    {
+        case PN_LPAREN:
+        case PN_LSQUARE:
+            ++nesting->parens;
+            break;
+
+        case PN_RPAREN:
+        case PN_RSQUARE:
+            nesting->parens -= nesting->parens > 0;
+            break;
+
+        // Parentheses don't cross braces, unless it's broken code.
+        case PN_LBRACE:
+            nesting->parens = 0;
+            ++nesting->braces;
+            break;
+
+        case PN_RBRACE:
+            nesting->parens = 0;
+            nesting->braces -= nesting->braces > 0;
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+//! Checks the next token outside of brackets for `synchronize()`.
+static bool stops_skipping(struct nesting_s *nesting, toknum_t start,
+                           bool in_block)
+{
+    if (nesting->braces > 0)
+        return false;
+
+    while (!in_block && next_is(PN_LBRACE))
+    {
+        nesting->parens = 0;
+        consume();
+    }
+
+    switch (peek(1))
+    {
+        case PN_SEMI:
+            if (nesting->parens > 0)
+                return false;
+
+            consume();
+            return true;
+
+        case PN_RBRACE:
+            if (!in_block)
+                consume();
+
+            return true;
+
+        case PN_LBRACE:
+            return current > start;
+
+        default:
+            return false;
+    }
+}
+
+
+/*!
+ * Skips the rest of the failed production, which starts at `start`, to the
+ * synchronizing token of the enclosing one. Brackets are skipped in pairs,
+ * including ones opened by the failed production. Then:
+ *   - ";" is consumed, it ends declarations and statements;
+ *   - "}" is consumed at the file scope, but it ends the enclosing block;
+ *   - "{" starts a statement in a block (e.g. after a loop macro), unless
+ *     the failed one is the block (too deep nesting), but it's skipped alone
+ *     at the file scope (e.g. extern "C" {).
+ * Each token is skipped once, so recovery is linear in the file size.
+ *
+ * Recoveries consume tokens, so there are no more of them than consumed
+ * tokens. Otherwise the parser is stuck, then the rest of the file is skipped
+ * with the warning shown w/o --verbose.
+ */
+static void synchronize(toknum_t start, bool in_block)
+{
+    struct nesting_s nesting = {0, 0};
+
+    if (++g_recoveries > released + current)
+    {
+        // Lines are still wanted by rules.
+        allow_eof = true;
+        peek(1);
+
+        failed = true;
+        add_warn_at(g_tokens[current].start,
+                    "Too many errors, the rest of the file is skipped");
+
+        while (peek(1) != TOK_EOF)
+            consume();
+
+        recover(0);
+    }
+
+    for (toknum_t i = start; i < current; ++i)
+        nest(&nesting, g_tokens[i].kind);
+
+    for (;;)
+    {
+        if (stops_skipping(&nesting, start, in_block))
+            return;
+
+        nest(&nesting, peek(1));
+        consume();
+    }
+}
+
+
+unsigned g_max_depth = 256;
+
+/*!
+ * It's called on entering productions, which can nest: statements, casts and
+ * unary, parenthesized and conditional expressions, declarators, structs and
+ * initializers. Chains are parsed in loops, so the call stack is bounded.
+ */
+static void descend(void)
+{
+    // Workers parse lexed tokens, so they stop here or between entities.
+    if (timed_out())
+        recover(0);
+
+    if (++level > g_max_depth)
+    {
+        // The token is pulled to be reported.
+        peek(1);
+        panic("Too deep nesting");
+    }
+}
+
+
+static inline tree_t ascend(tree_t tree)
+{
+    --level;
+    return tree;
+}
+
+
 ///////////////////
 // Constructors. //
 ///////////////////
@@ -630,6 +1126,8 @@ static tree_t finish_comp_member(toknum_t st, tree_t *designs, tree_t init)
 
 
 /*!
+ * Guesses whether the next unknown name starts a declaration.
+ *
  * In problem "X(Y)" we prefer expression to declaration.
  * In problem "X Y" we prefer declaration to expression (w/ macros).
  *
@@ -643,42 +1141,14 @@ static tree_t finish_comp_member(toknum_t st, tree_t *designs, tree_t init)
  *     "X)" "X,"    declaration
  *     "X(Y)("      declaration
  */
-static bool starts_declaration(bool agressive)
+static bool guess_declaration(bool agressive)
 {
-    switch (peek(1))
+    switch (peek(2))
     {
-        // Custom type or start of expression.
-        case TOK_IDENTIFIER:
-            // Look second token.
-            break;
-
-        // Storage class specifiers.
-        case KW_TYPEDEF: case KW_EXTERN: case KW_STATIC: case KW_REGISTER:
-        case KW_AUTO:
-        // Primitive type specifiers.
-        case KW_VOID: case KW_CHAR: case KW_SHORT: case KW_INT:
-        case KW_LONG: case KW_FLOAT: case KW_DOUBLE: case KW_SIGNED:
-        case KW_UNSIGNED: case KW_BOOL: case KW_COMPLEX:
-        // Type qualifiers.
-        case KW_CONST: case KW_RESTRICT: case KW_VOLATILE:
-        // Structures.
-        case KW_STRUCT: case KW_UNION: case KW_ENUM:
-        // Function specifier.
-        case KW_INLINE:
-        // Attributes.
-        case KW_ATTRIBUTE:
-            return true;
-
-        default:
-            return false;
-    }
-
-    switch (peek(2))
-    {
-        // "X)" and "X,".
-        case PN_RPAREN:
-        case PN_COMMA:
-            return agressive;
+        // "X)" and "X,".
+        case PN_RPAREN:
+        case PN_COMMA:
+            return agressive;
 
         case PN_STAR:
             // Look third token.
@@ -686,7 +1156,7 @@ static bool starts_declaration(bool agressive)
 
         case TOK_IDENTIFIER: case KW_TYPEDEF: case KW_ATTRIBUTE:
         case KW_EXTERN: case KW_STATIC: case KW_REGISTER: case KW_AUTO:
-        case KW_CONST: case KW_RESTRICT: case KW_VOLATILE:
+        case KW_THREAD: case KW_CONST: case KW_RESTRICT: case KW_VOLATILE:
             return true;
 
         // "X(Y)(" (e.g. "custom_t (fn)(int a) {}").
@@ -717,6 +1187,51 @@ static bool starts_declaration(bool agressive)
 }
 
 
+/*!
+ * Typedef names seen in the file and names hiding them are looked up, other
+ * names (e.g. types from headers) are guessed.
+ */
+static bool starts_declaration(bool agressive)
+{
+    atom_t kind;
+
+    switch (peek(1))
+    {
+        // Custom type or start of expression.
+        case TOK_IDENTIFIER:
+            // Labels are not declarations, unlike unnamed bit-fields.
+            if (!in_members && peek(2) == PN_COLON)
+                return false;
+
+            kind = lookup(g_tokens[current].atom);
+
+            // Unknown names (e.g. from headers) are guessed by next tokens.
+            return kind == SYM_NONE ? guess_declaration(agressive)
+                                    : kind == SYM_TYPEDEF;
+
+        // Storage class specifiers.
+        case KW_TYPEDEF: case KW_EXTERN: case KW_STATIC: case KW_REGISTER:
+        case KW_AUTO: case KW_THREAD:
+        // Primitive type specifiers.
+        case KW_VOID: case KW_CHAR: case KW_SHORT: case KW_INT:
+        case KW_LONG: case KW_FLOAT: case KW_DOUBLE: case KW_SIGNED:
+        case KW_UNSIGNED: case KW_BOOL: case KW_COMPLEX:
+        // Type qualifiers.
+        case KW_CONST: case KW_RESTRICT: case KW_VOLATILE:
+        // Structures.
+        case KW_STRUCT: case KW_UNION: case KW_ENUM:
+        // Function specifier.
+        case KW_INLINE:
+        // Attributes.
+        case KW_ATTRIBUTE:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
 static tree_t cast_expression(bool after_sizeof);
 static tree_t cast_expression_after_lparen(bool after_sizeof);
 static tree_t postfix_expression_suffixes(tree_t left);
@@ -728,7 +1243,7 @@ static tree_t constant_expression(void);
 
 static tree_t declaration(void);
 static tree_t declaration_inner(tree_t specs, tree_t first_declarator);
-static tree_t declaration_specifiers(bool agressive);
+static tree_t declaration_specifiers(bool only_quals);
 static tree_t struct_or_union_specifier(void);
 static tree_t enum_specifier(void);
 static tree_t init_declarator(void);
@@ -789,12 +1304,14 @@ static tree_t attribute(void);
 static tree_t cast_expression(bool after_sizeof)
 {
     tree_t left = NULL;
-    toknum_t st = current;
+    toknum_t st = current, value;
+
+    descend();
 
     switch (peek(1))
     {
         case PN_LPAREN:
-            return cast_expression_after_lparen(after_sizeof);
+            return ascend(cast_expression_after_lparen(after_sizeof));
 
         // Primary expression.
         case TOK_IDENTIFIER:
@@ -803,10 +1320,20 @@ static tree_t cast_expression(bool after_sizeof)
 
         case TOK_NUM_CONST:
         case TOK_CHAR_CONST:
-        case TOK_STRING:
             left = finish_constant(st, consume());
             break;
 
+        // Adjacent literals are concatenated, the first one is the value.
+        // Identifiers among them are macros like `PRIu64`.
+        case TOK_STRING:
+            value = consume();
+
+            while (next_is(TOK_STRING) || next_is(TOK_IDENTIFIER))
+                consume();
+
+            left = finish_constant(st, value);
+            break;
+
         // Prefix unary operators.
         case PN_PLUSPLUS:
         case PN_MINUSMINUS:
@@ -818,21 +1345,21 @@ static tree_t cast_expression(bool after_sizeof)
         case PN_EXCLAIM:
         {
             toknum_t op = consume();
-            return finish_unary(st, op, cast_expression(false));
+            return ascend(finish_unary(st, op, cast_expression(false)));
         }
 
         // `sizeof` operator.
         case KW_SIZEOF:
         {
             toknum_t op = consume();
-            return finish_unary(st, op, cast_expression(true));
+            return ascend(finish_unary(st, op, cast_expression(true)));
         }
 
         default:
             panic("Expected expression");
     }
 
-    return postfix_expression_suffixes(left);
+    return ascend(postfix_expression_suffixes(left));
 }
 
 
@@ -928,9 +1455,14 @@ static tree_t postfix_expression_suffixes(tree_t left)
             tree_t *args = new_tree_vec(2);
             consume();
 
+            // Macros can take type names, e.g. `va_arg(ap, struct s)`, but
+            // only ones starting with keywords are told from expressions.
             while (!accept(PN_RPAREN))
             {
-                vec_push(args, assignment_expression());
+                bool is_type = !next_is(TOK_IDENTIFIER) &&
+                               starts_declaration(false);
+
+                vec_push(args, is_type ? type_name() : assignment_expression());
                 next_is(PN_RPAREN) || expect(PN_COMMA);
             }
 
@@ -1009,17 +1541,28 @@ static tree_t binary_expression(void)
  */
 static tree_t conditional_expression(void)
 {
-    tree_t cond = binary_expression();
-    tree_t then_br, else_br;
+    size_t base = vec_len(links);
+    tree_t expr = binary_expression();
+
+    while (accept(PN_QUESTION))
+    {
+        tree_t then_br;
 
-    if (!accept(PN_QUESTION))
-        return cond;
+        descend();
+        then_br = ascend(expression());
+        expect(PN_COLON);
 
-    then_br = expression();
-    expect(PN_COLON);
-    else_br = conditional_expression();
+        vec_push(links, ((struct link_s){expr->start, 0, expr, then_br}));
+        expr = binary_expression();
+    }
+
+    while (vec_len(links) > base)
+    {
+        struct link_s link = vec_pop(links);
+        expr = finish_conditional(link.st, link.left, link.middle, expr);
+    }
 
-    return finish_conditional(cond->start, cond, then_br, else_br);
+    return expr;
 }
 
 
@@ -1036,10 +1579,11 @@ static tree_t conditional_expression(void)
  */
 static tree_t assignment_expression(void)
 {
-    tree_t lhs = conditional_expression();
+    size_t base = vec_len(links);
+    tree_t expr = conditional_expression();
     toknum_t op;
 
-    switch (peek(1))
+    for (;;) switch (peek(1))
     {
         case PN_EQ:
         // Multiplicative.
@@ -1051,13 +1595,19 @@ static tree_t assignment_expression(void)
         // Bitwise.
         case PN_AMPEQ: case PN_PIPEEQ: case PN_CARETEQ:
             op = consume();
+            vec_push(links, ((struct link_s){expr->start, op, expr, NULL}));
+            expr = conditional_expression();
             break;
 
         default:
-            return lhs;
-    }
+            while (vec_len(links) > base)
+            {
+                struct link_s link = vec_pop(links);
+                expr = finish_assignment(link.st, link.left, link.op, expr);
+            }
 
-    return finish_assignment(lhs->start, lhs, op, assignment_expression());
+            return expr;
+    }
 }
 
 
@@ -1106,7 +1656,7 @@ static inline tree_t constant_expression(void)
  */
 static tree_t declaration(void)
 {
-    tree_t specs = declaration_specifiers(true);
+    tree_t specs = declaration_specifiers(false);
 
     if (accept(PN_SEMI))
         return specs ? finish_declaration(specs->start, specs, NULL)
@@ -1128,6 +1678,7 @@ static tree_t declaration_inner(tree_t specs, tree_t first_declarator)
         vec_push(decls, init_declarator());
 
     expect(PN_SEMI);
+    bind_declaration(specs, decls);
     return finish_declaration(st, specs, decls);
 }
 
@@ -1160,7 +1711,7 @@ static tree_t declaration_inner(tree_t specs, tree_t first_declarator)
  *
  * We accept empty declaration specifiers.
  */
-static tree_t declaration_specifiers(bool agressive)
+static tree_t declaration_specifiers(bool only_quals)
 {
     toknum_t st = current;
     toknum_t storage = 0;
@@ -1194,8 +1745,9 @@ static tree_t declaration_specifiers(bool agressive)
             vec_push(names, consume());
             break;
 
-        // Type qualifiers.
-        case KW_CONST: case KW_RESTRICT: case KW_VOLATILE:
+        // Type qualifiers. GNU `__thread` can follow a storage class, so it's
+        // kept as a qualifier.
+        case KW_CONST: case KW_RESTRICT: case KW_VOLATILE: case KW_THREAD:
             if (!quals)
                 quals = new_toknum_vec(1);
 
@@ -1235,9 +1787,11 @@ static tree_t declaration_specifiers(bool agressive)
 
             break;
 
-        // Perhaps custom type.
+        // Perhaps custom type. Qualifiers of pointers and arrays can't
+        // contain typedef names, but macros there are guessed.
         case TOK_IDENTIFIER:
-            if (!(dirtype || names) && starts_declaration(agressive))
+            if (!(dirtype || names) && (only_quals ? guess_declaration(false)
+                                                   : starts_declaration(true)))
             {
                 names = new_toknum_vec(1);
                 vec_push(names, consume());
@@ -1292,6 +1846,7 @@ static tree_t struct_or_union_specifier(void)
     tree_t (*ctor)(toknum_t, toknum_t, tree_t *);
     toknum_t name;
     tree_t *members;
+    bool saved_in_members;
 
     ctor = peek(1) == KW_UNION ? finish_union : finish_struct;
     consume();
@@ -1302,13 +1857,18 @@ static tree_t struct_or_union_specifier(void)
     if (!accept(PN_LBRACE))
         return ctor(st, name, NULL);
 
+    descend();
+
     members = new_tree_vec(4);
+    saved_in_members = in_members;
+    in_members = true;
 
     // Members.
     while (!accept(PN_RBRACE))
         vec_push(members, declaration());
 
-    return ctor(st, name, members);
+    in_members = saved_in_members;
+    return ascend(ctor(st, name, members));
 }
 
 
@@ -1416,13 +1976,15 @@ static tree_t declarator_inner(toknum_t *name)
 {
     toknum_t st = current;
 
+    descend();
+
     if (accept(PN_STAR))
     {
-        tree_t specs = declaration_specifiers(false);
-        return finish_pointer(st, declarator_inner(name), specs);
+        tree_t specs = declaration_specifiers(true);
+        return ascend(finish_pointer(st, declarator_inner(name), specs));
     }
 
-    return direct_declarator_inner(name);
+    return ascend(direct_declarator_inner(name));
 }
 
 
@@ -1469,7 +2031,7 @@ static tree_t direct_declarator_inner(toknum_t *name)
             tree_t dimension = NULL;
             consume();
 
-            dim_specs = declaration_specifiers(false);
+            dim_specs = declaration_specifiers(true);
 
             if (next_is(PN_STAR))
             {
@@ -1539,7 +2101,7 @@ static tree_t *parameter_type_list(void)
             vec_push(params, finish_special(param_st, consume()));
         else
         {
-            tree_t specs = declaration_specifiers(true);
+            tree_t specs = declaration_specifiers(false);
             tree_t declarator = NULL;
 
             if (!(next_is(PN_COMMA) || next_is(PN_RPAREN)))
@@ -1574,7 +2136,10 @@ static tree_t *parameter_type_list(void)
 static tree_t compound_literal(tree_t type)
 {
     toknum_t st = type ? type->start : current;
-    tree_t *members = new_tree_vec(3);
+    tree_t *members;
+
+    descend();
+    members = new_tree_vec(3);
     expect(PN_LBRACE);
 
     while (!accept(PN_RBRACE))
@@ -1610,7 +2175,7 @@ static tree_t compound_literal(tree_t type)
             expect(PN_COMMA);
     }
 
-    return finish_comp_literal(st, type, members);
+    return ascend(finish_comp_literal(st, type, members));
 }
 
 
@@ -1633,7 +2198,7 @@ static tree_t initializer(void)
 static tree_t type_name(void)
 {
     toknum_t st = current;
-    tree_t specs = declaration_specifiers(true);
+    tree_t specs = declaration_specifiers(false);
     tree_t indtype, decl = NULL;
     toknum_t decl_st = current;
 
@@ -1657,9 +2222,9 @@ static tree_t type_name(void)
 static tree_t declaration_or_fn_definition(void)
 {
     toknum_t st = current;
-    tree_t specs = declaration_specifiers(true);
+    tree_t specs = declaration_specifiers(false);
     struct declarator_s *declarator;
-    bool is_function = false;
+    tree_t last;
 
     // Only ";".
     if (!specs && next_is(PN_SEMI))
@@ -1672,14 +2237,18 @@ static tree_t declaration_or_fn_definition(void)
     declarator = (struct declarator_s *)init_declarator();
 
     // Check last indirect type.
-    for (tree_t i = (tree_t)declarator; i; i = ((struct pointer_s *)i)->indtype)
-        is_function = i->type == FUNCTION;
+    last = (tree_t)declarator;
+    while (((struct pointer_s *)last)->indtype)
+        last = ((struct pointer_s *)last)->indtype;
 
     // Function definition.
-    if (is_function && !declarator->init && !next_is(PN_SEMI))
+    if (last->type == FUNCTION && !declarator->init && !next_is(PN_SEMI))
     {
         tree_t *old_decls = NULL;
         tree_t body;
+        unsigned scope = enter_scope();
+
+        bind_parameters(((struct function_s *)last)->params);
 
         // Old-style declaration list.
         if (!next_is(PN_LBRACE))
@@ -1690,6 +2259,8 @@ static tree_t declaration_or_fn_definition(void)
         }
 
         body = compound_statement();
+        leave_scope(scope);
+
         return finish_function_def(st, specs, (tree_t)declarator,
                                    old_decls, body);
     }
@@ -1714,36 +2285,38 @@ static tree_t declaration_or_fn_definition(void)
  */
 static tree_t statement(void)
 {
+    descend();
+
     switch (peek(1))
     {
         case KW_CASE:
         case KW_DEFAULT:
-            return labeled_statement();
+            return ascend(labeled_statement());
 
         case TOK_IDENTIFIER:
-            return peek(2) == PN_COLON ? labeled_statement()
-                                       : expression_statement();
+            return ascend(peek(2) == PN_COLON ? labeled_statement()
+                                              : expression_statement());
 
         case PN_LBRACE:
-            return compound_statement();
+            return ascend(compound_statement());
 
         case KW_IF:
         case KW_SWITCH:
-            return selection_statement();
+            return ascend(selection_statement());
 
         case KW_WHILE:
         case KW_DO:
         case KW_FOR:
-            return iteration_statement();
+            return ascend(iteration_statement());
 
         case KW_GOTO:
         case KW_CONTINUE:
         case KW_BREAK:
         case KW_RETURN:
-            return jump_statement();
+            return ascend(jump_statement());
 
         default:
-            return expression_statement();
+            return ascend(expression_statement());
     }
 }
 
@@ -1756,33 +2329,50 @@ static tree_t statement(void)
  */
 static tree_t labeled_statement(void)
 {
-    enum token_e kind = peek(1);
-    toknum_t st = consume();
+    size_t base = vec_len(links);
+    tree_t stmt;
 
-    switch (kind)
+    // Labels of the same statement are parsed in a loop.
+    do
     {
-        case KW_CASE:
-        {
-            tree_t const_expr = constant_expression();
-            expect(PN_COLON);
-            return finish_case(st, const_expr, statement());
-        }
+        toknum_t st = consume();
+        tree_t const_expr = NULL;
 
-        case TOK_IDENTIFIER:
+        if (g_tokens[st].kind == KW_CASE)
+            const_expr = constant_expression();
+
+        expect(PN_COLON);
+        vec_push(links, ((struct link_s){st, 0, const_expr, NULL}));
+    }
+    while (next_is(KW_CASE) || next_is(KW_DEFAULT) ||
+           (next_is(TOK_IDENTIFIER) && peek(2) == PN_COLON));
+
+    stmt = statement();
+
+    while (vec_len(links) > base)
+    {
+        struct link_s link = vec_pop(links);
+
+        switch (g_tokens[link.st].kind)
         {
-            expect(PN_COLON);
-            return finish_label(st, st, statement());
-        }
+            case KW_CASE:
+                stmt = finish_case(link.st, link.left, stmt);
+                break;
 
-        case KW_DEFAULT:
-            expect(PN_COLON);
-            return finish_default(st, statement());
+            case TOK_IDENTIFIER:
+                stmt = finish_label(link.st, link.st, stmt);
+                break;
 
-        default:
-            assert(0);
+            case KW_DEFAULT:
+                stmt = finish_default(link.st, stmt);
+                break;
+
+            default:
+                assert(0);
+        }
     }
 
-    return NULL;
+    return stmt;
 }
 
 
@@ -1802,7 +2392,9 @@ static tree_t compound_statement(void)
     toknum_t st = expect(PN_LBRACE);
     tree_t *entities = new_tree_vec(8);
 
+    unsigned scope = enter_scope();
     int recidx = push_recpoint();
+    volatile toknum_t item = current;
 
     for (;;)
         if (foothold(recidx))
@@ -1810,17 +2402,22 @@ static tree_t compound_statement(void)
             if (accept(PN_RBRACE))
                 break;
 
+            item = current;
             vec_push(entities, starts_declaration(true) ? declaration()
                                                         : statement());
         }
         else
         {
-            while (!(next_is(PN_SEMI) || next_is(PN_RBRACE)))
-                consume();
-            consume();
+            // Nested scopes are left by the jump.
+            leave_scope(scope + 1);
+            in_members = false;
+
+            synchronize(item, true);
+            item = current;
         }
 
     pop_recpoint();
+    leave_scope(scope);
 
     return finish_block(st, entities);
 }
@@ -1848,19 +2445,41 @@ static tree_t selection_statement(void)
 {
     toknum_t st = current;
 
-    if (accept(KW_IF))
+    if (next_is(KW_IF))
     {
-        tree_t cond, then_br, else_br = NULL;
+        size_t base = vec_len(links);
+        tree_t else_br = NULL;
 
-        expect(PN_LPAREN);
-        cond = expression();
-        expect(PN_RPAREN);
-        then_br = statement();
+        // Chains of "else if" are parsed in a loop.
+        for (;;)
+        {
+            tree_t cond, then_br;
+
+            st = consume();
+            expect(PN_LPAREN);
+            cond = expression();
+            expect(PN_RPAREN);
+            then_br = statement();
+
+            vec_push(links, ((struct link_s){st, 0, cond, then_br}));
+
+            if (!accept(KW_ELSE))
+                break;
+
+            if (!next_is(KW_IF))
+            {
+                else_br = statement();
+                break;
+            }
+        }
 
-        if (accept(KW_ELSE))
-            else_br = statement();
+        while (vec_len(links) > base)
+        {
+            struct link_s link = vec_pop(links);
+            else_br = finish_if(link.st, link.left, link.middle, else_br);
+        }
 
-        return finish_if(st, cond, then_br, else_br);
+        return else_br;
     }
 
     if (accept(KW_SWITCH))
@@ -1985,6 +2604,75 @@ static tree_t jump_statement(void)
 }
 
 
+/*!
+ * Pulls tokens ahead until the line after `line` is complete, because rules
+ * look at neighbouring lines.
+ */
+static void prefetch_lines(unsigned line)
+{
+    struct ahead_s item = {.known = true};
+
+    if (vec_len(ahead) > 0)
+        item = ahead[vec_len(ahead) - 1];
+    else
+        item.token = g_tokens[vec_len(g_tokens) - 1];
+
+    while (item.token.kind != TOK_EOF && item.token.start.line < line + 2)
+    {
+        item.known = pull_significant(&item.token);
+        vec_push(ahead, item);
+    }
+}
+
+
+/*!
+ * Checks entities parsed so far with the rest of consumed tokens and lines
+ * before the next token, then releases them. The first token of the file and
+ * the last consumed one are kept in the window, so the next part looks like
+ * the tail of the whole file for rules.
+ */
+static tree_t *finish_part(tree_t *entities, bool last)
+{
+    struct transl_unit_s *part;
+    toknum_t kept;
+
+    if (!last)
+        prefetch_lines(g_tokens[current].start.line);
+
+    g_part.last = last;
+    g_part.lines_from = g_part.lines_to;
+    g_part.lines_to = last ? vec_len(g_lines) : g_tokens[current].start.line;
+    g_part.tokens_from = g_part.first ? 2 : 3;
+    g_part.tokens_to = last ? vec_len(g_tokens) - 1 : current;
+
+    part = xmalloc(sizeof(*part));
+    *part = (struct transl_unit_s){T(TRANSL_UNIT), entities};
+    part->start = 1;
+    part->end = current - 1;
+
+    g_tree = (tree_t)part;
+    g_cached = false;
+    check_part();
+
+    dispose_tree(g_tree);
+    g_tree = NULL;
+    g_cached = false;
+    g_part.first = false;
+
+    if (last)
+        return new_tree_vec(0);
+
+    // Slide the window.
+    kept = vec_len(g_tokens) - (current - 1);
+    memmove(&g_tokens[2], &g_tokens[current - 1], kept * sizeof(token_t));
+    vec_len(g_tokens) = kept + 2;
+    released += current - 3;
+    current = 3;
+
+    return new_tree_vec(20);
+}
+
+
 /*!
  * C99 6.9 translation-unit:
  *     [external-declaration]+
@@ -2000,29 +2688,43 @@ static tree_t translation_unit(void)
 
     int eofidx = push_recpoint();
     int recidx = push_recpoint();
+    volatile toknum_t item = current;
+    bool not_eof;
 
-    bool not_eof = foothold(eofidx);
+    // Reset before the foothold, since the jump to the end of file returns
+    // there.
+    g_recoveries = 0;
+    not_eof = foothold(eofidx);
 
     while (not_eof)
         if (foothold(recidx))
         {
             allow_eof = true;
-            if (peek(1) == TOK_EOF)
+            if (peek(1) == TOK_EOF || timed_out())
                 break;
             allow_eof = false;
 
+            if (by_parts && current > PART_SIZE)
+                entities = finish_part(entities, false);
+
+            item = current;
             vec_push(entities, declaration_or_fn_definition());
         }
         else
         {
             allow_eof = false;
-            while (!(next_is(PN_SEMI) || next_is(PN_RBRACE)))
-                consume();
-            consume();
+            leave_scope(1);
+            in_members = false;
+
+            synchronize(item, false);
+            item = current;
         }
 
-    pop_recpoint();
-    pop_recpoint();
+    // The jump to the end of file skips points of nested blocks.
+    vec_len(recpoints) = eofidx;
+
+    if (by_parts)
+        entities = finish_part(entities, true);
 
     return finish_transl_unit(st, entities);
 }
@@ -2115,9 +2817,840 @@ static tree_t attribute(void)
 }
 
 
+////////////////////
+// Parallel mode. //
+////////////////////
+
+unsigned g_jobs = 1;
+
+#define CHUNK_SIZE 8192
+
+/*!
+ * Top-level entities of a chunk are parsed by a worker. Typedef names declared
+ * in previous chunks are guessed by `split_into_chunks()`, so the worker
+ * records its assumptions about outer names, which are checked in order.
+ */
+static struct chunk_s {
+    toknum_t from;
+    toknum_t to;
+    unsigned typedefs;          //!< Number of guessed typedef names before.
+    tree_t *entities;
+    bool failed;
+    error_t *logs;
+    struct assumption_s *assumptions;
+    atom_t *symbols;
+    struct binding_s *bindings;
+    pthread_t thread;
+} *chunks;
+
+//! Guessed typedef names at the file scope in order of declaration.
+static atom_t *typedefs;
+
+
+static void parse_chunk(struct chunk_s *chunk)
+{
+    struct transl_unit_s *unit;
+    error_t **outer = collect_logs(&chunk->logs);
+    current = chunk->from;
+    limit = chunk->to;
+    failed = false;
+
+    unit = (struct transl_unit_s *)translation_unit();
+    chunk->entities = unit->entities;
+    chunk->failed = failed;
+
+    // The unit is still in orphans.
+    process_orphans(true);
+    free(unit);
+
+    collect_logs(outer);
+}
+
+
+static void *run_worker(void *raw)
+{
+    struct chunk_s *chunk = raw;
+
+    recpoints = new_vec(struct recpoint_s, 1);
+    links = new_vec(struct link_s, 16);
+    orphans.trees = new_vec(tree_t, 50);
+    orphans.vectors = new_vec(void *, 15);
+    bindings = new_vec(struct binding_s, 64);
+    scopes = new_vec(unsigned, 16);
+    assumptions = new_vec(struct assumption_s, 64);
+
+    for (unsigned i = 0; i < chunk->typedefs; ++i)
+        atom_map_put(&inherited, typedefs[i], SYM_TYPEDEF);
+
+    parse_chunk(chunk);
+
+    chunk->assumptions = assumptions;
+    chunk->symbols = symbols;
+    chunk->bindings = bindings;
+
+    free_vec(recpoints);
+    free_vec(links);
+    free_vec(orphans.trees);
+    free_vec(orphans.vectors);
+    free_vec(scopes);
+
+    if (inherited)
+        free_vec(inherited);
+
+    return NULL;
+}
+
+
+//! State of `split_into_chunks()` between tokens.
+struct splitter_s {
+    unsigned depth;
+    enum token_e before_body;
+    bool in_typedef;
+};
+
+
+/*!
+ * Tracks brackets and typedef names, returns whether the token ends a
+ * top-level entity.
+ */
+static bool ends_entity(struct splitter_s *splitter, token_t *token)
+{
+    switch (token->kind)
+    {
+        case KW_TYPEDEF:
+            splitter->in_typedef = splitter->depth == 0;
+            return false;
+
+        case TOK_IDENTIFIER:
+            if (!splitter->in_typedef)
+                return false;
+
+            if (splitter->depth == 0 ? token[1].kind == PN_SEMI ||
+                                       token[1].kind == PN_COMMA
+                                     : splitter->depth == 1 &&
+                                       token[-1].kind == PN_STAR &&
+                                       token[1].kind == PN_RPAREN)
+                vec_push(typedefs, token->atom);
+
+            return false;
+
+        case PN_LBRACE:
+            if (splitter->depth++ == 0)
+                splitter->before_body = token[-1].kind;
+
+            return false;
+
+        case PN_LPAREN: case PN_LSQUARE:
+            ++splitter->depth;
+            return false;
+
+        case PN_RPAREN: case PN_RSQUARE:
+            splitter->depth -= splitter->depth > 0;
+            return false;
+
+        case PN_RBRACE:
+            splitter->depth -= splitter->depth > 0;
+            return splitter->depth == 0 && splitter->before_body == PN_RPAREN;
+
+        case PN_SEMI:
+            if (splitter->depth > 0)
+                return false;
+
+            splitter->in_typedef = false;
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+/*!
+ * Splits tokens into `count` chunks at the ends of top-level entities: `;` or
+ * `}` of a function body outside of any brackets. The split can be wrong,
+ * e.g. for K&R definitions, but then a worker fails.
+ *
+ * Typedef names are guessed on the way: identifiers before `;` or `,` outside
+ * of brackets and `*name)` of function pointers.
+ */
+static void split_into_chunks(unsigned count)
+{
+    toknum_t size = (vec_len(g_tokens) - 1) / count;
+    toknum_t from = 1;
+    struct splitter_s splitter = {0, TOK_UNKNOWN, false};
+    unsigned known = 0;
+
+    vec_len(chunks) = 0;
+    vec_len(typedefs) = 0;
+
+    for (toknum_t i = 1; i < vec_len(g_tokens) - 1; ++i)
+    {
+        if (!ends_entity(&splitter, &g_tokens[i]))
+            continue;
+
+        if (i + 1 - from >= size && vec_len(chunks) < count - 1)
+        {
+            vec_push(chunks, ((struct chunk_s){
+                .from = from, .to = i + 1, .typedefs = known
+            }));
+
+            from = i + 1;
+            known = vec_len(typedefs);
+        }
+    }
+
+    vec_push(chunks, ((struct chunk_s){
+        .from = from, .to = vec_len(g_tokens), .typedefs = known
+    }));
+}
+
+
+static bool assumptions_hold(struct chunk_s *chunk)
+{
+    for (unsigned i = 0; i < vec_len(chunk->assumptions); ++i)
+    {
+        struct assumption_s *assumption = &chunk->assumptions[i];
+
+        if (atom_map_get(symbols, assumption->atom) != assumption->kind)
+            return false;
+    }
+
+    return true;
+}
+
+
+/*!
+ * Merges the chunk parsed by a worker into the state of the main thread.
+ * The chunk is parsed again if the worker made wrong assumptions.
+ */
+static void merge_chunk(struct chunk_s *chunk)
+{
+    if (assumptions_hold(chunk))
+        for (unsigned i = 0; i < vec_len(chunk->bindings); ++i)
+        {
+            atom_t atom = chunk->bindings[i].atom;
+            bind(atom, atom_map_get(chunk->symbols, atom));
+        }
+    else
+    {
+        for (unsigned i = 0; i < vec_len(chunk->entities); ++i)
+            dispose_tree(chunk->entities[i]);
+
+        free_vec(chunk->entities);
+        drop_logs(chunk->logs);
+        chunk->logs = NULL;
+        parse_chunk(chunk);
+    }
+}
+
+
+static void release_chunk(struct chunk_s *chunk)
+{
+    free_vec(chunk->assumptions);
+    free_vec(chunk->bindings);
+
+    if (chunk->symbols)
+        free_vec(chunk->symbols);
+}
+
+
+/*!
+ * Lexes the rest of the file right into `g_tokens`. An unknown token stops it
+ * and waits in `ahead`, so the parser reaches it in order. Returns false then.
+ */
+static bool lex_ahead(void)
+{
+    token_t token;
+
+    do
+    {
+        if (!pull_significant(&token))
+        {
+            vec_push(ahead, ((struct ahead_s){token, false}));
+            return false;
+        }
+
+        vec_push(g_tokens, token);
+    }
+    while (token.kind != TOK_EOF);
+
+    return true;
+}
+
+
+/*!
+ * The whole file is lexed first, then chunks are parsed by workers and the
+ * main thread. If any chunk fails, all entities are discarded and the file is
+ * parsed serially, so errors and recovery are the same as in the serial mode.
+ */
+static tree_t parse_in_parallel(void)
+{
+    bool known = lex_ahead();
+    unsigned count;
+    bool any_failed = false;
+    tree_t *entities;
+
+    count = (vec_len(g_tokens) - 1) / CHUNK_SIZE;
+    count = count < g_jobs ? count : g_jobs;
+
+    // Unknown tokens aren't errors yet, leave them for the serial mode.
+    if (!known || count < 2)
+        return translation_unit();
+
+    if (!chunks)
+    {
+        chunks = new_vec(struct chunk_s, g_jobs);
+        typedefs = new_vec(atom_t, 64);
+    }
+
+    split_into_chunks(count);
+
+    for (unsigned i = 1; i < vec_len(chunks); ++i)
+        if (pthread_create(&chunks[i].thread, NULL, run_worker, &chunks[i]))
+            abort();
+
+    parse_chunk(&chunks[0]);
+    any_failed = chunks[0].failed;
+
+    for (unsigned i = 1; i < vec_len(chunks); ++i)
+    {
+        pthread_join(chunks[i].thread, NULL);
+
+        if (any_failed)
+            chunks[i].failed = true;
+        else
+            merge_chunk(&chunks[i]);
+
+        release_chunk(&chunks[i]);
+
+        any_failed = any_failed || chunks[i].failed;
+    }
+
+    entities = new_tree_vec(20);
+
+    for (unsigned i = 0; i < vec_len(chunks); ++i)
+    {
+        struct chunk_s *chunk = &chunks[i];
+
+        for (unsigned j = 0; j < vec_len(chunk->entities); ++j)
+            if (any_failed)
+                dispose_tree(chunk->entities[j]);
+            else
+                vec_push(entities, chunk->entities[j]);
+
+        free_vec(chunk->entities);
+
+        if (any_failed)
+            drop_logs(chunk->logs);
+        else
+            replay_logs(chunk->logs);
+    }
+
+    if (any_failed)
+    {
+        free_vec(entities);
+        leave_scope(0);
+        in_members = false;
+        current = 1;
+        limit = (toknum_t)-1;
+        return translation_unit();
+    }
+
+    current = vec_len(g_tokens) - 1;
+    return finish_transl_unit(1, entities);
+}
+
+
 void parse(void)
 {
     assert(g_tokens && vec_len(g_tokens) == 1);
     assert(!g_tree);
+
+    error_t *logs = NULL, **outer;
+
+    if (g_jobs > 1)
+    {
+        g_tree = parse_in_parallel();
+        return;
+    }
+
+    if (!g_pipelined)
+    {
+        g_tree = translation_unit();
+        return;
+    }
+
+    pipelining = true;
+
+    // `g_lines` is filled by the lexer thread, so nothing can be printed now.
+    outer = collect_logs(&logs);
+    start_pipeline();
+
     g_tree = translation_unit();
+
+    stop_pipeline();
+    pipelining = false;
+    collect_logs(outer);
+    replay_logs(logs);
+}
+
+
+/*!
+ * Parses the file and checks it part by part. Only the current part is
+ * kept in the tree and tokens. The lexer isn't pipelined in this mode,
+ * because rules read lines, which are written by the lexer.
+ */
+void check_by_parts(void)
+{
+    assert(g_tokens && vec_len(g_tokens) == 1);
+    assert(!g_tree);
+
+    g_part = (part_t){.first = true};
+    by_parts = true;
+    g_tree = translation_unit();
+    by_parts = false;
+}
+
+
+/////////////////////////
+// Checking of ranges. //
+/////////////////////////
+
+#define first_line(tree) g_tokens[(tree)->start].start.line
+#define last_line(tree) g_tokens[(tree)->end].end.line
+
+
+//! Returns the first token, which starts at `line` or later.
+static toknum_t find_token(unsigned line)
+{
+    toknum_t lo = 1, hi = vec_len(g_tokens) - 1;
+
+    while (lo < hi)
+    {
+        toknum_t mid = lo + (hi - lo) / 2;
+
+        if (g_tokens[mid].start.line < line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+/*!
+ * Checks the parsed file only at `ranges` of lines, which are sorted and
+ * disjoint. Ranges are extended to whole top-level entities they intersect
+ * and checked as parts, so the rest of the file isn't visited by rules.
+ * Errors outside `ranges` are dropped.
+ */
+void check_ranges(range_t *ranges)
+{
+    tree_t *entities = ((struct transl_unit_s *)g_tree)->entities;
+    tree_t *chosen = new_tree_vec(8);
+    unsigned count = vec_len(entities), next = 0, i = 0;
+    struct transl_unit_s part = {T(TRANSL_UNIT), NULL};
+    toknum_t last_token = vec_len(g_tokens) - 1;
+    tree_t whole = g_tree;
+
+    assert(!by_parts);
+    g_ranges = ranges;
+
+    while (i < vec_len(ranges))
+    {
+        unsigned from = ranges[i].from, to = ranges[i].to;
+        toknum_t tokens_from, tokens_to;
+
+        while (next < count && last_line(entities[next]) < from)
+            ++next;
+
+        vec_len(chosen) = 0;
+
+        // Take intersecting entities and ranges, which they reach.
+        for (++i;; ++i)
+        {
+            for (; next < count && first_line(entities[next]) < to; ++next)
+            {
+                tree_t entity = entities[next];
+
+                from = first_line(entity) < from ? first_line(entity) : from;
+                to = last_line(entity) >= to ? last_line(entity) + 1 : to;
+                entity->parent = (tree_t)&part;
+                vec_push(chosen, entity);
+            }
+
+            if (i == vec_len(ranges) || ranges[i].from >= to)
+                break;
+
+            to = ranges[i].to > to ? ranges[i].to : to;
+        }
+
+        to = to < vec_len(g_lines) ? to : vec_len(g_lines);
+        tokens_from = find_token(from);
+        tokens_to = find_token(to);
+
+        g_part = (part_t){
+            true, to == vec_len(g_lines), from, to,
+            tokens_from > 2 ? tokens_from : 2,
+            tokens_to < last_token ? tokens_to : last_token
+        };
+
+        part.entities = chosen;
+        part.start = 1;
+        part.end = g_part.tokens_to - 1;
+
+        g_tree = (tree_t)&part;
+        g_cached = false;
+        check_part();
+
+        for (unsigned j = 0; j < vec_len(chosen); ++j)
+            chosen[j]->parent = whole;
+    }
+
+    g_tree = whole;
+    g_cached = false;
+    g_ranges = NULL;
+    free_vec(chosen);
+}
+
+
+///////////////////////////
+// Incremental checking. //
+///////////////////////////
+
+static unsigned find_line(line_t *lines, const char *pos)
+{
+    unsigned lo = 0, hi = vec_len(lines);
+
+    while (hi - lo > 1)
+    {
+        unsigned mid = lo + (hi - lo) / 2;
+
+        if (lines[mid].start <= pos)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+static bool same_token(token_t *old, token_t *new, int lines_delta)
+{
+    unsigned length = old->end.pos + 1 - old->start.pos;
+
+    return old->kind == new->kind &&
+           old->start.column == new->start.column &&
+           old->end.column == new->end.column &&
+           old->start.line + lines_delta == new->start.line &&
+           old->end.line + lines_delta == new->end.line &&
+           new->end.pos + 1 - new->start.pos == length &&
+           !memcmp(old->start.pos, new->start.pos, length);
+}
+
+
+//! The declaration changes file-scope names in the current scope.
+static bool binds_names(tree_t entity, token_t *tokens)
+{
+    struct declaration_s *decl = (struct declaration_s *)entity;
+
+    if (entity->type != DECLARATION || !decl->decls)
+        return false;
+
+    if (decl->specs && tokens[((struct specifiers_s *)decl->specs)->storage]
+                           .kind == KW_TYPEDEF)
+        return true;
+
+    for (unsigned i = 0; i < vec_len(decl->decls); ++i)
+    {
+        toknum_t name = ((struct declarator_s *)decl->decls[i])->name;
+
+        if (name && lookup(tokens[name].atom) == SYM_TYPEDEF)
+            return true;
+    }
+
+    return false;
+}
+
+
+//! The start of the entity or the end of the last one.
+static toknum_t start_of_entity(tree_t *entities, unsigned i)
+{
+    if (i < vec_len(entities))
+        return entities[i]->start;
+
+    return i > 0 ? entities[i - 1]->end + 1 : 1;
+}
+
+
+static bool shares_line(toknum_t token)
+{
+    return g_tokens[token - 1].end.line == g_tokens[token].start.line;
+}
+
+
+/*!
+ * The state of the previous check: tokens, lines and data are already
+ * replaced, but the tree and errors belong to the previous data.
+ */
+static struct {
+    token_t *tokens;
+    line_t *lines;
+    char *data;
+    suppression_t *suppressions;
+} prev;
+
+
+//! Errors of reused entities are kept only if suppressions are the same.
+static bool same_suppressions(void)
+{
+    if (!prev.suppressions || !g_suppressions)
+        return prev.suppressions == g_suppressions;
+
+    return vec_len(prev.suppressions) == vec_len(g_suppressions) &&
+           !memcmp(prev.suppressions, g_suppressions,
+                   vec_len(g_suppressions) * sizeof(*g_suppressions));
+}
+
+
+//! Drops errors of replaced lines and shifts errors of following lines.
+static void patch_errors(unsigned from, unsigned to, int delta)
+{
+    unsigned kept = 0;
+
+    if (!g_errors)
+        return;
+
+    for (unsigned i = 0; i < vec_len(g_errors); ++i)
+    {
+        error_t error = g_errors[i];
+
+        if (from <= error.line && error.line < to)
+            continue;
+
+        if (error.line >= to)
+            error.line += delta;
+
+        g_errors[kept++] = error;
+    }
+
+    vec_len(g_errors) = kept;
+}
+
+
+/*!
+ * Reparses only top-level entities touched by the change, keeping others with
+ * shifted token numbers, and checks lines of reparsed entities. Changed
+ * lines are covered by whole lines of reparsed entities, because rules (e.g.
+ * indentation) look at lines. Gives up if it can't be done as in the serial
+ * mode: there are errors or declarations of typedef names are changed.
+ */
+static bool reparse_changes(void)
+{
+    struct transl_unit_s *unit = (struct transl_unit_s *)g_tree, *part;
+    tree_t *old = unit->entities, *entities, whole;
+    struct chunk_s chunk = {0};
+    unsigned count = vec_len(old), first = 0, last;
+    toknum_t old_len = vec_len(prev.tokens), new_len = vec_len(g_tokens);
+    toknum_t prefix = 1, suffix = 0, from, to;
+    int tokens_delta = new_len - old_len;
+    int lines_delta = vec_len(g_lines) - vec_len(prev.lines);
+    unsigned head = 0, tail = 0, old_size, new_size;
+    unsigned changed_from, changed_to, lines_from, lines_to, marks;
+
+    // Find changed bytes, lines and tokens.
+    while (prev.data[head] && prev.data[head] == g_data[head])
+        ++head;
+
+    old_size = head + strlen(prev.data + head);
+    new_size = head + strlen(g_data + head);
+
+    while (tail < old_size - head && tail < new_size - head &&
+           prev.data[old_size - tail - 1] == g_data[new_size - tail - 1])
+        ++tail;
+
+    changed_from = find_line(g_lines, g_data + head);
+    changed_to = find_line(g_lines, g_data + (new_size - tail > head ?
+                                              new_size - tail - 1 : head));
+
+    while (prefix < old_len && prefix < new_len &&
+           same_token(&prev.tokens[prefix], &g_tokens[prefix], 0))
+        ++prefix;
+
+    while (suffix < old_len - prefix && suffix < new_len - prefix &&
+           same_token(&prev.tokens[old_len - suffix - 1],
+                      &g_tokens[new_len - suffix - 1], lines_delta))
+        ++suffix;
+
+    // Find entities to reparse: [first, last).
+    while (first < count && old[first]->end + 1 < prefix)
+        ++first;
+
+    from = start_of_entity(old, first);
+
+    while (first > 0 && (g_tokens[from - 1].end.line >= changed_from ||
+                         shares_line(from)))
+        from = start_of_entity(old, --first);
+
+    for (last = first; last < count; ++last)
+        if (old[last]->start >= old_len - suffix)
+            break;
+
+    to = start_of_entity(old, last) + tokens_delta;
+
+    while (last < count && (g_tokens[to].start.line <= changed_to ||
+                            shares_line(to)))
+        to = start_of_entity(old, ++last) + tokens_delta;
+
+    if (last == count)
+        to = new_len - 1;
+
+    assert(from <= to);
+
+    lines_from = from > 1 ? g_tokens[from - 1].end.line + 1 : 0;
+    lines_to = last < count ? g_tokens[to].start.line : vec_len(g_lines);
+
+    // Typedef names of the file scope before the changed entities.
+    for (unsigned i = 0; i < first; ++i)
+    {
+        struct declaration_s *decl = (struct declaration_s *)old[i];
+
+        if (decl->type == DECLARATION && decl->decls)
+            bind_declaration(decl->specs, decl->decls);
+    }
+
+    for (unsigned i = first; i < last; ++i)
+        if (last < count && binds_names(old[i], prev.tokens))
+            return false;
+
+    marks = vec_len(bindings);
+    chunk.from = from;
+    chunk.to = to;
+    parse_chunk(&chunk);
+
+    if (chunk.failed || chunk.logs ||
+        (last < count && vec_len(bindings) > marks))
+    {
+        for (unsigned i = 0; i < vec_len(chunk.entities); ++i)
+            dispose_tree(chunk.entities[i]);
+
+        free_vec(chunk.entities);
+        drop_logs(chunk.logs);
+        return false;
+    }
+
+    // Replace the entities.
+    entities = new_tree_vec(count + vec_len(chunk.entities));
+
+    for (unsigned i = 0; i < first; ++i)
+        vec_push(entities, old[i]);
+
+    for (unsigned i = 0; i < vec_len(chunk.entities); ++i)
+        vec_push(entities, chunk.entities[i]);
+
+    for (unsigned i = last; i < count; ++i)
+    {
+        shift_tree(old[i], tokens_delta);
+        vec_push(entities, old[i]);
+    }
+
+    for (unsigned i = first; i < last; ++i)
+        dispose_tree(old[i]);
+
+    free_vec(old);
+    free(unit);
+
+    current = new_len - 1;
+    whole = finish_transl_unit(1, entities);
+
+    for (unsigned i = 0; i < vec_len(entities); ++i)
+        entities[i]->parent = whole;
+
+    // Check reparsed entities.
+    patch_errors(lines_from, lines_to - lines_delta, lines_delta);
+
+    g_part = (part_t){
+        true, last == count, lines_from, lines_to, from > 2 ? from : 2, to
+    };
+
+    part = xmalloc(sizeof(*part));
+    *part = (struct transl_unit_s){T(TRANSL_UNIT), chunk.entities};
+    part->start = 1;
+    part->end = to - 1;
+
+    g_tree = (tree_t)part;
+    g_cached = false;
+    check_part();
+
+    g_tree = whole;
+    g_cached = false;
+    free(part);
+    free_vec(chunk.entities);
+    return true;
+}
+
+
+/*!
+ * Checks the changed `data` of the current file, which must be checked before
+ * in the serial mode. Returns false if the whole file is checked again.
+ */
+bool check_changes(char *data)
+{
+    error_t *logs = NULL;
+    bool clean = !failed;
+    bool known, reused = false;
+
+    assert(g_tree && g_tokens && !by_parts);
+
+    prev.tokens = g_tokens;
+    prev.lines = g_lines;
+    prev.data = g_data;
+    prev.suppressions = g_suppressions;
+
+    g_data = data;
+    g_tokens = NULL;
+    g_lines = NULL;
+    g_suppressions = NULL;
+    init_parser();
+
+    // Errors of the lexer are located, so they can't be patched.
+    collect_logs(&logs);
+    known = lex_ahead();
+    collect_logs(NULL);
+
+    if (clean && known && !logs && same_suppressions())
+        reused = reparse_changes();
+
+    if (!reused)
+    {
+        dispose_tree(g_tree);
+        g_tree = NULL;
+        g_cached = false;
+
+        patch_errors(0, (unsigned)-1, 0);
+        replay_logs(logs);
+
+        leave_scope(0);
+        in_members = false;
+        current = 1;
+        limit = (toknum_t)-1;
+        failed = false;
+
+        g_tree = translation_unit();
+        check_rules();
+    }
+
+    // Messages of dropped errors aren't kept over edits.
+    renew_messages(g_errors);
+
+    release_data(prev.data);
+    keep_vec(g_spare.lines, prev.lines);
+    keep_vec(g_spare.tokens, prev.tokens);
+
+    if (prev.suppressions)
+        free_vec(prev.suppressions);
+
+    return reused;
 }
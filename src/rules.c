@@ -17,6 +17,20 @@
 RULES(XX)
 #undef XX
 
+enum rule_e {
+#define XX(name) RULE_ ## name,
+    RULES(XX)
+#undef XX
+    RULES_COUNT
+};
+
+
+part_t g_part;
+const char *g_rule = NULL;
+range_t *g_ranges = NULL;
+
+//! The bit of the checked rule in masks of suppressions.
+static uint32_t rule_bit = 0;
 
 static jmp_buf cfgbuf;
 static struct rule_s *current;
@@ -148,11 +162,222 @@ bool configure_rules(void)
 
 
 void check_rules(void)
+{
+    g_part = (part_t){
+        true, true, 0, vec_len(g_lines), 2, vec_len(g_tokens) - 1
+    };
+    check_part();
+}
+
+
+void check_part(void)
 {
 #define XX(name)                                                              \
-    if ((name ## _rule).config)                                               \
-        (name ## _rule).check();
+    if ((name ## _rule).config && !timed_out())                               \
+    {                                                                         \
+        g_rule = #name;                                                       \
+        rule_bit = 1u << RULE_ ## name;                                       \
+        (name ## _rule).check();                                              \
+    }
+
+    RULES(XX)
+#undef XX
+
+    g_rule = NULL;
+    rule_bit = 0;
+}
+
+
+///////////////////
+// Suppressions. //
+///////////////////
 
+#define ALL_RULES ((1u << RULES_COUNT) - 1)
+
+static const char *rule_names[] = {
+#define XX(name) #name,
     RULES(XX)
 #undef XX
+};
+
+
+static bool starts_with(const char *str, const char *end, const char *prefix)
+{
+    size_t len = strlen(prefix);
+    return (size_t)(end - str) >= len && !memcmp(str, prefix, len);
+}
+
+
+/*!
+ * Returns the mask of rules, which names are separated by spaces or commas
+ * and can be followed by "--" and an explanation. No names mean all rules,
+ * unknown names are warned and mean none.
+ */
+static uint32_t parse_rules(const char *str, const char *end, unsigned line,
+                            unsigned column)
+{
+    uint32_t mask = 0;
+    bool named = false;
+
+    for (;;)
+    {
+        const char *name;
+        unsigned i;
+
+        while (str < end && (*str == ' ' || *str == '\t' || *str == ','))
+            ++str;
+
+        if (str == end || starts_with(str, end, "--"))
+            break;
+
+        name = str;
+        named = true;
+        while (str < end && *str != ' ' && *str != '\t' && *str != ',')
+            ++str;
+
+        for (i = 0; i < RULES_COUNT; ++i)
+            if (strlen(rule_names[i]) == (size_t)(str - name) &&
+                !memcmp(rule_names[i], name, str - name))
+                break;
+
+        if (i < RULES_COUNT)
+            mask |= 1u << i;
+        else
+            add_warn(line, column, "Unknown rule \"%.*s\" to suppress",
+                     (int)(str - name), name);
+    }
+
+    return named ? mask : ALL_RULES;
+}
+
+
+//! Returns the index of the boundary at `line`, which is inserted if need.
+static unsigned split_at(unsigned line)
+{
+    suppression_t boundary = {line, 0, 0};
+    unsigned i = vec_len(g_suppressions);
+
+    // Comments come in order, so boundaries are inserted near the end.
+    while (i > 0 && g_suppressions[i - 1].line > line)
+        --i;
+
+    if (i > 0 && g_suppressions[i - 1].line == line)
+        return i - 1;
+
+    if (i > 0)
+        boundary.range = g_suppressions[i - 1].range;
+
+    vec_push(g_suppressions, boundary);
+    memmove(&g_suppressions[i + 1], &g_suppressions[i],
+            (vec_len(g_suppressions) - 1 - i) * sizeof(*g_suppressions));
+    g_suppressions[i] = boundary;
+
+    return i;
+}
+
+
+//! Checks that `text` starts with the word of a directive.
+static bool is_directive(const char *text, const char *end, const char *word)
+{
+    size_t len = strlen(word);
+
+    return starts_with(text, end, word) && (text + len == end ||
+           text[len] == ' ' || text[len] == '\t' || text[len] == ',');
+}
+
+
+/*!
+ * Indexes a suppression by the text of a comment, which ends at `line`.
+ * Ranges start at the line of `clint-disable` and end at the line of
+ * `clint-enable` inclusively.
+ */
+void add_suppression(unsigned line, unsigned column, const char *text,
+                     const char *end)
+{
+    enum {NEXT_LINE, DISABLE, ENABLE} kind;
+    uint32_t mask;
+    unsigned i;
+
+    if (is_directive(text, end, "clint-disable-next-line"))
+        kind = NEXT_LINE, text += 23;
+    else if (is_directive(text, end, "clint-disable"))
+        kind = DISABLE, text += 13;
+    else if (is_directive(text, end, "clint-enable"))
+        kind = ENABLE, text += 12;
+    else
+        return;
+
+    if (!(mask = parse_rules(text, end, line, column)))
+        return;
+
+    if (!g_suppressions)
+        g_suppressions = new_vec(suppression_t, 8);
+
+    switch (kind)
+    {
+        case NEXT_LINE:
+            split_at(line + 2);
+            g_suppressions[split_at(line + 1)].once |= mask;
+            break;
+
+        case DISABLE:
+            for (i = split_at(line); i < vec_len(g_suppressions); ++i)
+                g_suppressions[i].range |= mask;
+            break;
+
+        case ENABLE:
+            for (i = split_at(line + 1); i < vec_len(g_suppressions); ++i)
+                g_suppressions[i].range &= ~mask;
+            break;
+    }
+}
+
+
+//! Checks whether `line` is out of `g_ranges`.
+static bool is_out_of_ranges(unsigned line)
+{
+    unsigned lo = 0, hi = vec_len(g_ranges);
+
+    while (lo < hi)
+    {
+        unsigned mid = (lo + hi) / 2;
+
+        if (g_ranges[mid].to <= line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo == vec_len(g_ranges) || g_ranges[lo].from > line;
+}
+
+
+//! Checks whether the checked rule is suppressed at `line`.
+bool is_suppressed(unsigned line)
+{
+    unsigned lo = 0, hi;
+
+    if (!rule_bit)
+        return false;
+
+    if (g_ranges && is_out_of_ranges(line))
+        return true;
+
+    if (!g_suppressions)
+        return false;
+
+    // Looks for the last boundary not after the line.
+    hi = vec_len(g_suppressions);
+    while (lo < hi)
+    {
+        unsigned mid = (lo + hi) / 2;
+
+        if (g_suppressions[mid].line <= line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo > 0 && (g_suppressions[lo - 1].range |
+                      g_suppressions[lo - 1].once) & rule_bit;
 }
@@ -0,0 +1,261 @@
+/*!
+ * @brief It splits files between shards and merges results of shards.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <json.h>
+
+#include "clint.h"
+
+
+/////////////
+// Shards. //
+/////////////
+
+//! Every file costs something regardless of its size.
+#define FILE_WEIGHT 4096
+
+static struct discovered_s {
+    char *path;
+    uint64_t weight;
+    uint64_t hash;
+} *discovered = NULL;
+
+
+void discover_file(const char *path, uint64_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (const char *ch = path; *ch; ++ch)
+        hash = (hash ^ (unsigned char)*ch) * 1099511628211ULL;
+
+    if (!discovered)
+        discovered = new_vec(struct discovered_s, 256);
+
+    vec_push(discovered, ((struct discovered_s){
+        xstrdup(path), size + FILE_WEIGHT, hash
+    }));
+}
+
+
+//! The heaviest files first, then by hashes of paths, so the order is stable.
+static int compare_by_weight(const void *a, const void *b)
+{
+    const struct discovered_s *left = a, *right = b;
+
+    if (left->weight != right->weight)
+        return left->weight < right->weight ? 1 : -1;
+
+    if (left->hash != right->hash)
+        return left->hash < right->hash ? -1 : 1;
+
+    return strcmp(left->path, right->path);
+}
+
+
+static int compare_paths(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+
+/*!
+ * Assigns discovered files to shards greedily: each file goes to the
+ * lightest shard, so all shards agree without communication. Returns paths
+ * of the shard `index` of `count` (1-based) in order, the rest is dropped.
+ */
+char **take_shard(unsigned index, unsigned count)
+{
+    uint64_t *loads = xcalloc(count, sizeof(*loads));
+    unsigned total = discovered ? vec_len(discovered) : 0;
+    char **mine = new_vec(char *, total / count + 1);
+
+    if (total)
+        qsort(discovered, total, sizeof(*discovered), compare_by_weight);
+
+    for (unsigned i = 0; i < total; ++i)
+    {
+        unsigned lightest = 0;
+
+        for (unsigned j = 1; j < count; ++j)
+            if (loads[j] < loads[lightest])
+                lightest = j;
+
+        loads[lightest] += discovered[i].weight;
+
+        if (lightest == index - 1)
+            vec_push(mine, discovered[i].path);
+        else
+            free(discovered[i].path);
+    }
+
+    qsort(mine, vec_len(mine), sizeof(*mine), compare_paths);
+
+    if (discovered)
+        free_vec(discovered);
+
+    discovered = NULL;
+    free(loads);
+    return mine;
+}
+
+
+/////////////////////////
+// Merging of results. //
+/////////////////////////
+
+//! Errors of results of shards with their files.
+static struct merged_s {
+    char *file;
+    unsigned order;
+    error_t error;
+} *merged = NULL;
+
+static unsigned next_merged = 0;    //!< Reported by `take_merged()` before.
+
+
+//! Errors share names of rules, "syntax" is `NULL`.
+static const char *intern_rule(const char *name)
+{
+    static char **rules = NULL;
+
+    if (!strcmp(name, "syntax"))
+        return NULL;
+
+    if (!rules)
+        rules = new_vec(char *, 8);
+
+    for (unsigned i = 0; i < vec_len(rules); ++i)
+        if (!strcmp(rules[i], name))
+            return rules[i];
+
+    vec_push(rules, xstrdup(name));
+    return rules[vec_len(rules) - 1];
+}
+
+
+static bool add_merged(json_value *record)
+{
+    json_value *file = find_field(record, "file"),
+               *line = find_field(record, "line"),
+               *column = find_field(record, "column"),
+               *rule = find_field(record, "rule"),
+               *severity = find_field(record, "severity"),
+               *message = find_field(record, "message");
+
+    if (!has_type(file, string) || !has_type(line, integer) ||
+        !has_type(column, integer) || !has_type(rule, string) ||
+        !has_type(severity, string) || !has_type(message, string) ||
+        line->u.integer < 1 || column->u.integer < 1)
+        return false;
+
+    if (!merged)
+        merged = new_vec(struct merged_s, 1024);
+
+    vec_push(merged, ((struct merged_s){
+        xstrdup(file->u.string.ptr), vec_len(merged), {
+            !strcmp(severity->u.string.ptr, "warning"),
+            line->u.integer - 1, column->u.integer - 1,
+            xstrdup(message->u.string.ptr), intern_rule(rule->u.string.ptr)
+        }
+    }));
+
+    return true;
+}
+
+
+/*!
+ * Reads the result of a shard: errors in jsonl and the final `status`.
+ * Returns false if the result is broken or incomplete.
+ */
+bool read_result(FILE *fp, int *status)
+{
+    size_t capacity = 0;
+    char *buf = NULL;
+    bool complete = false, broken = false;
+
+    while (!complete && !broken && read_line(fp, &buf, &capacity))
+    {
+        json_value *record = json_parse(buf, strlen(buf)), *value;
+
+        if (!record)
+        {
+            broken = true;
+            continue;
+        }
+
+        if ((value = find_field(record, "status")))
+        {
+            complete = has_type(value, integer) && value->u.integer >= 0 &&
+                       value->u.integer <= INT32_MAX;
+            broken = !complete;
+
+            if (complete)
+                *status = value->u.integer;
+        }
+        else
+            broken = !add_merged(record);
+
+        json_value_free(record);
+    }
+
+    free(buf);
+    return complete;
+}
+
+
+static int compare_merged(const void *a, const void *b)
+{
+    const struct merged_s *left = a, *right = b;
+    int res = strcmp(left->file, right->file);
+
+    if (res)
+        return res;
+
+    return left->order < right->order ? -1 : left->order > right->order;
+}
+
+
+/*!
+ * Sets `g_filename` and `g_errors` to the next file of read results sorted
+ * by files, which are freed by `reset_state()`. Returns false at the end.
+ */
+bool take_merged(void)
+{
+    if (!merged)
+        return false;
+
+    if (!next_merged)
+        qsort(merged, vec_len(merged), sizeof(*merged), compare_merged);
+
+    if (next_merged == vec_len(merged))
+    {
+        free_vec(merged);
+        merged = NULL;
+        next_merged = 0;
+        return false;
+    }
+
+    g_filename = merged[next_merged].file;
+    g_errors = new_vec(error_t, 8);
+
+    for (; next_merged < vec_len(merged) &&
+           !strcmp(merged[next_merged].file, g_filename); ++next_merged)
+    {
+        error_t error = merged[next_merged].error;
+
+        // Messages of `g_errors` are released by `reset_state()`.
+        error.message = copy_message(error.message);
+        free(merged[next_merged].error.message);
+        vec_push(g_errors, error);
+
+        if (merged[next_merged].file != g_filename)
+            free(merged[next_merged].file);
+    }
+
+    return true;
+}
@@ -4,6 +4,7 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "clint.h"
 
@@ -15,24 +16,132 @@ tree_t g_tree = NULL;
 bool g_cached = false;
 token_t *g_tokens = NULL;
 error_t *g_errors = NULL;
+suppression_t *g_suppressions = NULL;
 json_value *g_config = NULL;
 
+size_t g_spare_limit = 16 << 20;
+struct spare_s g_spare = {NULL, NULL, NULL};
+
+//! The buffer, which `alloc_data()` lends to `g_data`.
+static struct {
+    char *ptr;
+    size_t capacity;
+} data_buffer = {NULL, 0};
+
+
+//! Returns the data buffer of at least `size` bytes for the current file.
+char *alloc_data(size_t size)
+{
+    if (size > data_buffer.capacity)
+    {
+        free(data_buffer.ptr);
+        data_buffer.ptr = xmalloc(size);
+        data_buffer.capacity = size;
+    }
+
+    return data_buffer.ptr;
+}
+
+
+//! Frees `data`, unless it's the data buffer that can be reused.
+void release_data(char *data)
+{
+    if (data != data_buffer.ptr)
+        free(data);
+    else if (data_buffer.capacity > g_spare_limit)
+    {
+        free(data_buffer.ptr);
+        data_buffer.ptr = NULL;
+        data_buffer.capacity = 0;
+    }
+}
+
+
+unsigned g_file_timeout = 0;
+bool (*g_interrupter)(void) = NULL;
+
+//! The deadline of the current file, `expired` is set by any thread.
+static struct {
+    bool started;
+    bool expired;
+    struct timespec deadline;
+} timer = {false, false, {0, 0}};
+
+//! The clock is read once per so many polls of a thread.
+#define POLLS_PER_READ 256
+
+
+//! Starts the budget of `g_file_timeout` ms for the current file.
+void start_timer(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &timer.deadline);
+    timer.deadline.tv_sec += g_file_timeout / 1000;
+    timer.deadline.tv_nsec += g_file_timeout % 1000 * 1000000L;
+
+    if (timer.deadline.tv_nsec >= 1000000000L)
+    {
+        ++timer.deadline.tv_sec;
+        timer.deadline.tv_nsec -= 1000000000L;
+    }
+
+    timer.started = true;
+    timer.expired = false;
+}
+
+
+bool (timed_out)(void)
+{
+    static __thread unsigned polls = 0;
+    struct timespec now;
+
+    if (!timer.started)
+        return false;
+
+    if (__atomic_load_n(&timer.expired, __ATOMIC_RELAXED))
+        return true;
+
+    if (++polls % POLLS_PER_READ)
+        return false;
+
+    if (!g_interrupter || !g_interrupter())
+    {
+        if (!g_file_timeout)
+            return false;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        if (now.tv_sec < timer.deadline.tv_sec ||
+            (now.tv_sec == timer.deadline.tv_sec &&
+             now.tv_nsec < timer.deadline.tv_nsec))
+            return false;
+    }
+
+    __atomic_store_n(&timer.expired, true, __ATOMIC_RELAXED);
+    return true;
+}
+
 
 void reset_state(void)
 {
     free(g_filename);
-    free(g_data);
+    release_data(g_data);
+
+    // The tree, lines and tokens of a cached file are mapped.
+    if (!unmap_cache())
+    {
+        if (g_tree)
+            dispose_tree(g_tree);
 
-    if (g_tree)
-        dispose_tree(g_tree);
+        keep_vec(g_spare.lines, g_lines);
+        keep_vec(g_spare.tokens, g_tokens);
 
-    if (g_errors)
-        for (unsigned i = 0; i < vec_len(g_errors); ++i)
-            free(g_errors[i].message);
+        if (g_suppressions)
+            free_vec(g_suppressions);
+    }
 
-    free_vec(g_lines);
-    free_vec(g_tokens);
-    free_vec(g_errors);
+    release_messages();
+    keep_vec(g_spare.errors, g_errors);
+    reset_baseline();
 
     g_filename = NULL;
     g_data = NULL;
@@ -41,4 +150,8 @@ void reset_state(void)
     g_cached = false;
     g_tokens = NULL;
     g_errors = NULL;
+    g_suppressions = NULL;
+    g_recoveries = 0;
+    timer.started = false;
+    timer.expired = false;
 }
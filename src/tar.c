@@ -0,0 +1,227 @@
+/*!
+ * @brief It reads members of tar archives of `--tar` without extracting them.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clint.h"
+
+
+#define TAR_BLOCK 512
+#define padded(size) (((size) + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK)
+
+
+static bool skip_bytes(FILE *fp, uint64_t size)
+{
+    char buf[8192];
+
+    while (size > 0)
+    {
+        size_t len = size < sizeof(buf) ? size : sizeof(buf);
+
+        if (fread(buf, 1, len, fp) != len)
+            return false;
+
+        size -= len;
+    }
+
+    return true;
+}
+
+
+//! Parses an octal field or a base-256 one of GNU tar.
+static uint64_t parse_number(const unsigned char *field, size_t len)
+{
+    uint64_t value = 0;
+    size_t i = 0;
+
+    if (field[0] & 0x80)
+    {
+        value = field[0] & 0x3f;
+
+        for (i = 1; i < len; ++i)
+            value = value << 8 | field[i];
+
+        return value;
+    }
+
+    while (i < len && field[i] == ' ')
+        ++i;
+
+    for (; i < len && field[i] >= '0' && field[i] <= '7'; ++i)
+        value = value * 8 + (field[i] - '0');
+
+    return value;
+}
+
+
+//! The checksum counts its own field as spaces.
+static bool valid_header(const unsigned char *block)
+{
+    uint64_t sum = 8 * ' ';
+
+    for (unsigned i = 0; i < TAR_BLOCK; ++i)
+        if (i < 148 || i >= 156)
+            sum += block[i];
+
+    return sum == parse_number(block + 148, 8);
+}
+
+
+//! Finds the "path" record of pax extended headers.
+static char *find_pax_path(const char *data, uint64_t size)
+{
+    const char *record = data;
+
+    while (record < data + size)
+    {
+        char *end;
+        uint64_t len = strtoull(record, &end, 10);
+
+        if (!len || *end != ' ' || len > (size_t)(data + size - record))
+            break;
+
+        if (!strncmp(end + 1, "path=", 5))
+        {
+            size_t path_len = record + len - 1 - (end + 6);
+            char *path = xmalloc(path_len + 1);
+
+            memcpy(path, end + 6, path_len);
+            path[path_len] = '\0';
+            return path;
+        }
+
+        record += len;
+    }
+
+    return NULL;
+}
+
+
+//! Reads the extended header of `type`, which names the next member.
+static bool read_long_name(tar_t *tar, char type, uint64_t size)
+{
+    char *data = xmalloc(size + 1), *path;
+
+    if (!read_member(tar, data, size))
+    {
+        free(data);
+        return false;
+    }
+
+    path = type == 'x' ? find_pax_path(data, size) : xstrdup(data);
+    free(data);
+
+    if (path)
+    {
+        free(tar->long_name);
+        tar->long_name = path;
+    }
+
+    return true;
+}
+
+
+//! Joins the prefix and name fields of ustar.
+static char *member_name(const unsigned char *block)
+{
+    const char *fields = (const char *)block;
+    char name[257];
+
+    if (!memcmp(fields + 257, "ustar", 5) && fields[345])
+        snprintf(name, sizeof(name), "%.155s/%.100s", fields + 345, fields);
+    else
+        snprintf(name, sizeof(name), "%.100s", fields);
+
+    return xstrdup(name);
+}
+
+
+/*!
+ * Reads headers up to the next regular file of `tar` and returns its name,
+ * which is valid until the next call, and `size`. Its content must be read
+ * or skipped then. Returns `NULL` at the end of the archive, where `ended`
+ * is set unless the archive is broken or truncated.
+ */
+const char *next_member(tar_t *tar, uint64_t *size)
+{
+    unsigned char block[TAR_BLOCK];
+    unsigned zeros = 0;
+    bool ok = true;
+
+    free(tar->name);
+    tar->name = NULL;
+
+    while (ok && zeros < 2 && fread(block, 1, TAR_BLOCK, tar->fp) == TAR_BLOCK)
+    {
+        // The archive ends with two zero blocks.
+        if (!block[0] && !memcmp(block, block + 1, TAR_BLOCK - 1))
+        {
+            ++zeros;
+            continue;
+        }
+
+        zeros = 0;
+
+        if (!valid_header(block))
+            return NULL;
+
+        *size = parse_number(block + 124, 12);
+
+        switch (block[156])
+        {
+            // Extended headers of pax and GNU tar name the next member.
+            case 'x':
+            case 'L':
+                ok = read_long_name(tar, block[156], *size);
+                break;
+
+            case '0':
+            case '7':
+            case '\0':
+                tar->name = tar->long_name ? tar->long_name
+                                           : member_name(block);
+                tar->long_name = NULL;
+                return tar->name;
+
+            default:
+                ok = skip_member(tar, *size);
+                free(tar->long_name);
+                tar->long_name = NULL;
+        }
+    }
+
+    tar->ended = ok && zeros > 0;
+    return NULL;
+}
+
+
+//! Reads the content of `size` into `data` of `size + 1` with a NUL.
+bool read_member(tar_t *tar, char *data, uint64_t size)
+{
+    if (fread(data, 1, size, tar->fp) != size ||
+        !skip_bytes(tar->fp, padded(size) - size))
+        return false;
+
+    data[size] = '\0';
+    return true;
+}
+
+
+bool skip_member(tar_t *tar, uint64_t size)
+{
+    return skip_bytes(tar->fp, padded(size));
+}
+
+
+//! Frees names of `tar`, but doesn't close its stream.
+void free_tar(tar_t *tar)
+{
+    free(tar->name);
+    free(tar->long_name);
+    tar->name = tar->long_name = NULL;
+}
@@ -24,6 +24,7 @@
     XX(KW_COMPLEX, "_Complex")                                                \
     XX(KW_IMAGINARY, "_Imaginary")                                            \
     XX(KW_ATTRIBUTE, "__attribute__")                                         \
+    XX(KW_THREAD, "__thread")                                                 \
     XX(KW_AUTO, "auto")                                                       \
     XX(KW_BREAK, "break")                                                     \
     XX(KW_CASE, "case")                                                       \
@@ -140,9 +141,13 @@ typedef struct {
 } location_t;
 
 
+typedef unsigned atom_t;
+
+
 typedef struct {
     enum token_e kind;
     location_t start, end;
+    atom_t atom;
 } token_t;
 
 
@@ -8,66 +8,139 @@
 #include "tokens.h"
 
 
-enum type_e {
-    // Top level.
-    TRANSL_UNIT,        // {entities[]}
-    EMPTY,              // {}
-
-    // Declarations.
-    DECLARATION,        // {specs*, decls*[]}
-    SPECIFIERS,         // {#storage*, #fnspec*, #quals*[], dirtype*, attrs*[]}
-    DECLARATOR,         // {indtype*, #name*, init*, bitsize*, attrs*[]}
-    FUNCTION_DEF,       // {specs, decl, old_decls*[], body}
-    PARAMETER,          // {specs*, decl*} (decl can be ellipsis)
-    TYPE_NAME,          // {specs*, decl*} (abstract decl)
-
-    ATTRIBUTE,          // {attribs*[]}
-    ATTRIB,             // {name, args*[]}
-
-    // Direct types.
-    ID_TYPE,            // {#names[]}
-    STRUCT,             // {#name*, members*[]}
-    UNION,              // {#name*, members*[]}
-    ENUM,               // {#name*, values*[]}
-    ENUMERATOR,         // {#name, value*}
-
-    // Indirect types.
-    POINTER,            // {indtype*, specs*}
-    ARRAY,              // {indtype*, dim_specs*, dim*}
-    FUNCTION,           // {indtype*, params[]}
-
-    // Statements.
-    BLOCK,              // {entities[]}
-    IF,                 // {cond, then_br, else_br*}
-    SWITCH,             // {cond, body}
-    WHILE,              // {cond, body}
-    DO_WHILE,           // {cond, body}
-    FOR,                // {init*, cond*, next*, body}
-    GOTO,               // {#label}
-    BREAK,              // {}
-    CONTINUE,           // {}
-    RETURN,             // {result}
+/*!
+ * The schema of nodes: `XX(type, name, word)` declares `struct name_s` with
+ * fields listed by `type_FIELDS(F, name)` in the walk order. Each field is
+ * listed as `F(name, kind, prop)`, where the kind is one of `TOKEN`, `TOKENS`
+ * (vector), `NODE` and `NODES` (vector). Missing fields are 0 or `NULL`.
+ */
+//!@{
+#define NODE_MAP(XX)                                                          \
+    /* Top level. */                                                          \
+    XX(TRANSL_UNIT,  transl_unit,  "transl-unit")                             \
+    XX(EMPTY,        empty,        "empty")                                   \
+    /* Declarations. */                                                       \
+    XX(DECLARATION,  declaration,  "declaration")                             \
+    XX(SPECIFIERS,   specifiers,   "specifiers")                              \
+    XX(DECLARATOR,   declarator,   "declarator")                              \
+    XX(FUNCTION_DEF, function_def, "function-def")                            \
+    XX(PARAMETER,    parameter,    "parameter")                               \
+    XX(TYPE_NAME,    type_name,    "type-name")                               \
+    XX(ATTRIBUTE,    attribute,    "attribute")                               \
+    XX(ATTRIB,       attrib,       "attrib")                                  \
+    /* Direct types. */                                                       \
+    XX(ID_TYPE,      id_type,      "id-type")                                 \
+    XX(STRUCT,       struct,       "struct")                                  \
+    XX(UNION,        union,        "union")                                   \
+    XX(ENUM,         enum,         "enum")                                    \
+    XX(ENUMERATOR,   enumerator,   "enumerator")                              \
+    /* Indirect types. */                                                     \
+    XX(POINTER,      pointer,      "pointer")                                 \
+    XX(ARRAY,        array,        "array")                                   \
+    XX(FUNCTION,     function,     "function")                                \
+    /* Statements. */                                                         \
+    XX(BLOCK,        block,        "block")                                   \
+    XX(IF,           if,           "if")                                      \
+    XX(SWITCH,       switch,       "switch")                                  \
+    XX(WHILE,        while,        "while")                                   \
+    XX(DO_WHILE,     do_while,     "do-while")                                \
+    XX(FOR,          for,          "for")                                     \
+    XX(GOTO,         goto,         "goto")                                    \
+    XX(BREAK,        break,        "break")                                   \
+    XX(CONTINUE,     continue,     "continue")                                \
+    XX(RETURN,       return,       "return")                                  \
+    /* Labels. */                                                             \
+    XX(LABEL,        label,        "label")                                   \
+    XX(DEFAULT,      default,      "default")                                 \
+    XX(CASE,         case,         "case")                                    \
+    /* Expressions. */                                                        \
+    XX(CONSTANT,     constant,     "constant")                                \
+    XX(IDENTIFIER,   identifier,   "identifier")                              \
+    XX(SPECIAL,      special,      "special")                                 \
+    XX(ACCESSOR,     accessor,     "accessor")                                \
+    XX(COMMA,        comma,        "comma")                                   \
+    XX(CALL,         call,         "call")                                    \
+    XX(CAST,         cast,         "cast")                                    \
+    XX(CONDITIONAL,  conditional,  "conditional")                             \
+    XX(SUBSCRIPT,    subscript,    "subscript")                               \
+    XX(UNARY,        unary,        "unary")                                   \
+    XX(BINARY,       binary,       "binary")                                  \
+    XX(ASSIGNMENT,   assignment,   "assignment")                              \
+    XX(COMP_LITERAL, comp_literal, "comp-literal")                            \
+    XX(COMP_MEMBER,  comp_member,  "comp-member")
+
+
+#define TRANSL_UNIT_FIELDS(F, S)  F(S, NODES, entities)
+#define EMPTY_FIELDS(F, S)
+#define DECLARATION_FIELDS(F, S)  F(S, NODE, specs) F(S, NODES, decls)
+#define SPECIFIERS_FIELDS(F, S)                                               \
+    F(S, TOKEN, storage) F(S, TOKEN, fnspec) F(S, TOKENS, quals)              \
+    F(S, NODE, dirtype) F(S, NODES, attrs)
+// The `indtype` is a chain of pointers, arrays and functions applied to the
+// specifiers, the `name` is missing in abstract declarators.
+#define DECLARATOR_FIELDS(F, S)                                               \
+    F(S, NODE, indtype) F(S, TOKEN, name) F(S, NODE, init)                    \
+    F(S, NODE, bitsize) F(S, NODES, attrs)
+// The `old_decls` declare parameters of K&R definitions.
+#define FUNCTION_DEF_FIELDS(F, S)                                             \
+    F(S, NODE, specs) F(S, NODE, decl) F(S, NODES, old_decls)                 \
+    F(S, NODE, body)
+// The `decl` is ellipsis or abstract in some parameters and in type names.
+#define PARAMETER_FIELDS(F, S)    F(S, NODE, specs) F(S, NODE, decl)
+#define TYPE_NAME_FIELDS(F, S)    F(S, NODE, specs) F(S, NODE, decl)
+#define ATTRIBUTE_FIELDS(F, S)    F(S, NODES, attribs)
+#define ATTRIB_FIELDS(F, S)       F(S, TOKEN, name) F(S, NODES, args)
+#define ID_TYPE_FIELDS(F, S)      F(S, TOKENS, names)
+#define STRUCT_FIELDS(F, S)       F(S, TOKEN, name) F(S, NODES, members)
+#define UNION_FIELDS(F, S)        F(S, TOKEN, name) F(S, NODES, members)
+#define ENUM_FIELDS(F, S)         F(S, TOKEN, name) F(S, NODES, values)
+#define ENUMERATOR_FIELDS(F, S)   F(S, TOKEN, name) F(S, NODE, value)
+#define POINTER_FIELDS(F, S)      F(S, NODE, indtype) F(S, NODE, specs)
+// The `dim_specs` are qualifiers and `static` within brackets.
+#define ARRAY_FIELDS(F, S)                                                    \
+    F(S, NODE, indtype) F(S, NODE, dim_specs) F(S, NODE, dim)
+#define FUNCTION_FIELDS(F, S)     F(S, NODE, indtype) F(S, NODES, params)
+#define BLOCK_FIELDS(F, S)        F(S, NODES, entities)
+#define IF_FIELDS(F, S)                                                       \
+    F(S, NODE, cond) F(S, NODE, then_br) F(S, NODE, else_br)
+#define SWITCH_FIELDS(F, S)       F(S, NODE, cond) F(S, NODE, body)
+#define WHILE_FIELDS(F, S)        F(S, NODE, cond) F(S, NODE, body)
+#define DO_WHILE_FIELDS(F, S)     F(S, NODE, cond) F(S, NODE, body)
+#define FOR_FIELDS(F, S)                                                      \
+    F(S, NODE, init) F(S, NODE, cond) F(S, NODE, next) F(S, NODE, body)
+#define GOTO_FIELDS(F, S)         F(S, TOKEN, label)
+#define BREAK_FIELDS(F, S)
+#define CONTINUE_FIELDS(F, S)
+#define RETURN_FIELDS(F, S)       F(S, NODE, result)
+#define LABEL_FIELDS(F, S)        F(S, TOKEN, name) F(S, NODE, stmt)
+#define DEFAULT_FIELDS(F, S)      F(S, NODE, stmt)
+#define CASE_FIELDS(F, S)         F(S, NODE, expr) F(S, NODE, stmt)
+#define CONSTANT_FIELDS(F, S)     F(S, TOKEN, value)
+#define IDENTIFIER_FIELDS(F, S)   F(S, TOKEN, value)
+#define SPECIAL_FIELDS(F, S)      F(S, TOKEN, value)
+#define ACCESSOR_FIELDS(F, S)                                                 \
+    F(S, NODE, left) F(S, TOKEN, op) F(S, TOKEN, field)
+#define COMMA_FIELDS(F, S)        F(S, NODES, exprs)
+#define CALL_FIELDS(F, S)         F(S, NODE, left) F(S, NODES, args)
+#define CAST_FIELDS(F, S)         F(S, NODE, type_name) F(S, NODE, expr)
+#define CONDITIONAL_FIELDS(F, S)                                              \
+    F(S, NODE, cond) F(S, NODE, then_br) F(S, NODE, else_br)
+#define SUBSCRIPT_FIELDS(F, S)    F(S, NODE, left) F(S, NODE, index)
+#define UNARY_FIELDS(F, S)        F(S, TOKEN, op) F(S, NODE, expr)
+#define BINARY_FIELDS(F, S)                                                   \
+    F(S, NODE, left) F(S, TOKEN, op) F(S, NODE, right)
+#define ASSIGNMENT_FIELDS(F, S)                                               \
+    F(S, NODE, left) F(S, TOKEN, op) F(S, NODE, right)
+#define COMP_LITERAL_FIELDS(F, S) F(S, NODE, type_name) F(S, NODES, members)
+// The `designs` are designators (`.x`, `[1]`) before `=`.
+#define COMP_MEMBER_FIELDS(F, S)  F(S, NODES, designs) F(S, NODE, init)
+//!@}
 
-    // Labels.
-    LABEL,              // {#name, stmt}
-    DEFAULT,            // {stmt}
-    CASE,               // {expr, stmt}
 
-    // Expressions.
-    CONSTANT,           // {#value}
-    IDENTIFIER,         // {#value}
-    SPECIAL,            // {#value}
-    ACCESSOR,           // {left, #op, #field}
-    COMMA,              // {exprs[]}
-    CALL,               // {left, args[]}
-    CAST,               // {type_name, expr}
-    CONDITIONAL,        // {cond, then_br, else_br}
-    SUBSCRIPT,          // {left, index}
-    UNARY,              // {#op, expr}
-    BINARY,             // {left, #op, right}
-    ASSIGNMENT,         // {left, #op, right}
-    COMP_LITERAL,       // {type_name*, members[]}
-    COMP_MEMBER         // {designs*[], init}
+enum type_e {
+#define XX(type, name, word) type,
+    NODE_MAP(XX)
+#undef XX
 };
 
 
@@ -82,319 +155,19 @@ typedef struct tree_s {
 } *tree_t;
 
 
-//#TODO: add documentation.
-
-struct transl_unit_s {
-    TREE_FIELDS;
-    tree_t *entities;
-};
-
-
-struct empty_s {
-    TREE_FIELDS;
-};
-
-
-struct declaration_s {
-    TREE_FIELDS;
-    tree_t specs;
-    tree_t *decls;
-};
-
-
-struct specifiers_s {
-    TREE_FIELDS;
-    toknum_t storage;
-    toknum_t fnspec;
-    toknum_t *quals;
-    tree_t dirtype;
-    tree_t *attrs;
-};
-
-
-struct declarator_s {
-    TREE_FIELDS;
-    tree_t indtype;
-    toknum_t name;
-    tree_t init;
-    tree_t bitsize;
-    tree_t *attrs;
-};
-
-
-struct function_def_s {
-    TREE_FIELDS;
-    tree_t specs;
-    tree_t decl;
-    tree_t *old_decls;
-    tree_t body;
-};
-
-
-struct parameter_s {
-    TREE_FIELDS;
-    tree_t specs;
-    tree_t decl;
-};
-
-
-struct type_name_s {
-    TREE_FIELDS;
-    tree_t specs;
-    tree_t decl;
-};
-
-
-struct attribute_s {
-    TREE_FIELDS;
-    tree_t *attribs;
-};
-
-
-struct attrib_s {
-    TREE_FIELDS;
-    toknum_t name;
-    tree_t *args;
-};
-
-
-struct id_type_s {
-    TREE_FIELDS;
-    toknum_t *names;
-};
-
-
-struct struct_s {
-    TREE_FIELDS;
-    toknum_t name;
-    tree_t *members;
-};
-
-
-struct union_s {
-    TREE_FIELDS;
-    toknum_t name;
-    tree_t *members;
-};
-
-
-struct enum_s {
-    TREE_FIELDS;
-    toknum_t name;
-    tree_t *values;
-};
-
-
-struct enumerator_s {
-    TREE_FIELDS;
-    toknum_t name;
-    tree_t value;
-};
-
-
-struct pointer_s {
-    TREE_FIELDS;
-    tree_t indtype;
-    tree_t specs;
-};
-
-
-struct array_s {
-    TREE_FIELDS;
-    tree_t indtype;
-    tree_t dim_specs;
-    tree_t dim;
-};
-
-
-struct function_s {
-    TREE_FIELDS;
-    tree_t indtype;
-    tree_t *params;
-};
-
-
-struct block_s {
-    TREE_FIELDS;
-    tree_t *entities;
-};
-
-
-struct if_s {
-    TREE_FIELDS;
-    tree_t cond;
-    tree_t then_br;
-    tree_t else_br;
-};
-
-
-struct switch_s {
-    TREE_FIELDS;
-    tree_t cond;
-    tree_t body;
-};
-
-
-struct while_s {
-    TREE_FIELDS;
-    tree_t cond;
-    tree_t body;
-};
-
-
-struct do_while_s {
-    TREE_FIELDS;
-    tree_t cond;
-    tree_t body;
-};
-
-
-struct for_s {
-    TREE_FIELDS;
-    tree_t init;
-    tree_t cond;
-    tree_t next;
-    tree_t body;
-};
-
-
-struct goto_s {
-    TREE_FIELDS;
-    toknum_t label;
-};
-
-
-struct break_s {
-    TREE_FIELDS;
-};
-
-
-struct continue_s {
-    TREE_FIELDS;
-};
-
-
-struct return_s {
-    TREE_FIELDS;
-    tree_t result;
-};
-
-
-struct label_s {
-    TREE_FIELDS;
-    toknum_t name;
-    tree_t stmt;
-};
-
-
-struct default_s {
-    TREE_FIELDS;
-    tree_t stmt;
-};
-
-
-struct case_s {
-    TREE_FIELDS;
-    tree_t expr;
-    tree_t stmt;
-};
-
-
-struct constant_s {
-    TREE_FIELDS;
-    toknum_t value;
-};
-
-
-struct identifier_s {
-    TREE_FIELDS;
-    toknum_t value;
-};
-
-
-struct special_s {
-    TREE_FIELDS;
-    toknum_t value;
-};
-
-
-struct accessor_s {
-    TREE_FIELDS;
-    tree_t left;
-    toknum_t op;
-    toknum_t field;
-};
-
-
-struct comma_s {
-    TREE_FIELDS;
-    tree_t *exprs;
-};
-
-
-struct call_s {
-    TREE_FIELDS;
-    tree_t left;
-    tree_t *args;
-};
-
-
-struct cast_s {
-    TREE_FIELDS;
-    tree_t type_name;
-    tree_t expr;
-};
-
-
-struct conditional_s {
-    TREE_FIELDS;
-    tree_t cond;
-    tree_t then_br;
-    tree_t else_br;
-};
-
-
-struct subscript_s {
-    TREE_FIELDS;
-    tree_t left;
-    tree_t index;
-};
-
-
-struct unary_s {
-    TREE_FIELDS;
-    toknum_t op;
-    tree_t expr;
-};
-
-
-struct binary_s {
-    TREE_FIELDS;
-    tree_t left;
-    toknum_t op;
-    tree_t right;
-};
-
-
-struct assignment_s {
-    TREE_FIELDS;
-    tree_t left;
-    toknum_t op;
-    tree_t right;
-};
-
-
-struct comp_literal_s {
-    TREE_FIELDS;
-    tree_t type_name;
-    tree_t *members;
-};
-
-
-struct comp_member_s {
-    TREE_FIELDS;
-    tree_t *designs;
-    tree_t init;
-};
+#define FIELD_TOKEN     toknum_t
+#define FIELD_TOKENS    toknum_t *
+#define FIELD_NODE      tree_t
+#define FIELD_NODES     tree_t *
+
+#define FIELD(name, kind, prop) FIELD_ ## kind prop;
+#define XX(type, name, word)                                                  \
+    struct name ## _s {                                                       \
+        TREE_FIELDS;                                                          \
+        type ## _FIELDS(FIELD, name)                                          \
+    };
+NODE_MAP(XX)
+#undef XX
+#undef FIELD
 
 #endif  // __TREE_H__
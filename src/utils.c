@@ -3,6 +3,7 @@
  */
 
 #include <assert.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -73,8 +74,6 @@ char *xstrdup(const char *src)
  * <---------- header ----------><--------- data ---------->
  */
 
-#define VEC_HEADER_SIZE (sizeof(size_t) * 3)
-
 void *(new_vec)(size_t elem_sz, size_t init_capacity)
 {
     size_t *res = xmalloc(VEC_HEADER_SIZE + elem_sz * init_capacity);
@@ -116,6 +115,277 @@ void free_vec(void *vec)
 }
 
 
+size_t vec_size(void *vec)
+{
+    size_t *header = vec;
+    return VEC_HEADER_SIZE + header[-3] * header[-1];
+}
+
+
+//! Takes `*spare` (if it's set) as an empty vector of at least `capacity`.
+void *(reuse_vec)(void **spare, size_t elem_sz, size_t capacity)
+{
+    size_t *vec = *spare;
+
+    *spare = NULL;
+
+    if (!vec)
+        return (new_vec)(elem_sz, capacity);
+
+    assert(vec[-3] == elem_sz);
+
+    // The content is dropped anyway, so the vector isn't reallocated.
+    if (vec[-2] < capacity)
+    {
+        free_vec(vec);
+        return (new_vec)(elem_sz, capacity);
+    }
+
+    vec[-1] = 0;
+    return vec;
+}
+
+
+//! Keeps `vec` in `*spare`, unless it's larger than `g_spare_limit` bytes.
+void (keep_vec)(void **spare, void *vec)
+{
+    size_t *header = vec;
+
+    if (!vec || header[-3] * header[-2] > g_spare_limit)
+    {
+        free_vec(vec);
+        return;
+    }
+
+    free_vec(*spare);
+    *spare = vec;
+}
+
+
+//! Copies the vector to `dest` of `vec_size()` bytes w/o spare capacity.
+void *copy_vec(void *vec, void *dest)
+{
+    size_t *header = vec, *res = dest;
+
+    res[0] = header[-3];
+    res[1] = header[-1];
+    res[2] = header[-1];
+    memcpy(res + 3, vec, header[-3] * header[-1]);
+
+    return res + 3;
+}
+
+
+////////////
+// Atoms. //
+////////////
+
+static struct atom_s {
+    const char *name;
+    unsigned length;
+    unsigned hash;
+    unsigned shape;
+} *atoms = NULL;
+
+//! Open addressing, 0 means an empty slot.
+static atom_t *atom_slots = NULL;
+static unsigned atom_slots_mask = 0;
+
+
+static unsigned hash_name(const char *name, unsigned length)
+{
+    // FNV-1a.
+    unsigned hash = 2166136261u;
+
+    for (unsigned i = 0; i < length; ++i)
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+
+    return hash;
+}
+
+
+static unsigned get_shape(const char *name, unsigned length)
+{
+    unsigned shape = length && name[0] == '_' ? SHAPE_UNDERSCORE : 0;
+
+    for (unsigned i = 0; i < length; ++i)
+        if ('A' <= name[i] && name[i] <= 'Z')
+            shape |= SHAPE_UPPER;
+        else if ('0' <= name[i] && name[i] <= '9')
+            shape |= SHAPE_DIGIT;
+
+    return shape;
+}
+
+
+static void grow_atom_slots(void)
+{
+    unsigned size = atom_slots ? (atom_slots_mask + 1) * 2 : 4096;
+
+    free(atom_slots);
+    atom_slots = xcalloc(size, sizeof(atom_t));
+    atom_slots_mask = size - 1;
+
+    for (atom_t atom = 1; atom < vec_len(atoms); ++atom)
+    {
+        unsigned i = atoms[atom].hash & atom_slots_mask;
+
+        while (atom_slots[i])
+            i = (i + 1) & atom_slots_mask;
+
+        atom_slots[i] = atom;
+    }
+}
+
+
+atom_t intern(const char *name, unsigned length)
+{
+    unsigned hash = hash_name(name, length), i;
+    char *copy;
+
+    if (!atoms)
+    {
+        // The zeroth atom is reserved for tokens other than identifiers.
+        atoms = new_vec(struct atom_s, 1024);
+        vec_push(atoms, ((struct atom_s){"", 0, 0, 0}));
+    }
+
+    // Keep the load factor below 1/2.
+    if (2 * vec_len(atoms) > atom_slots_mask)
+        grow_atom_slots();
+
+    for (i = hash & atom_slots_mask; atom_slots[i];
+         i = (i + 1) & atom_slots_mask)
+    {
+        struct atom_s *atom = &atoms[atom_slots[i]];
+
+        if (atom->hash == hash && atom->length == length &&
+            !memcmp(atom->name, name, length))
+            return atom_slots[i];
+    }
+
+    copy = xmalloc(length + 1);
+    memcpy(copy, name, length);
+    copy[length] = '\0';
+
+    atom_slots[i] = vec_len(atoms);
+    vec_push(atoms, ((struct atom_s){copy, length, hash,
+                                     get_shape(name, length)}));
+
+    return atom_slots[i];
+}
+
+
+const char *atom_name(atom_t atom)
+{
+    assert(atoms && atom < vec_len(atoms));
+    return atoms[atom].name;
+}
+
+
+unsigned atom_length(atom_t atom)
+{
+    assert(atoms && atom < vec_len(atoms));
+    return atoms[atom].length;
+}
+
+
+unsigned atom_shape(atom_t atom)
+{
+    assert(atoms && atom < vec_len(atoms));
+    return atoms[atom].shape;
+}
+
+
+void atom_map_put(atom_t **map, atom_t key, atom_t value)
+{
+    assert(map);
+
+    if (!*map)
+        *map = new_vec(atom_t, key + 1);
+
+    while (vec_len(*map) <= key)
+        vec_push((*map), 0);
+
+    (*map)[key] = value;
+}
+
+
+///////////
+// JSON. //
+///////////
+
+//! Prints `len` bytes of `str` as a quoted and escaped JSON string.
+void print_json_string(FILE *fp, const char *str, size_t len)
+{
+    putc('"', fp);
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        unsigned char ch = str[i];
+
+        if (ch == '"' || ch == '\\')
+        {
+            putc('\\', fp);
+            putc(ch, fp);
+        }
+        else if (ch == '\n')
+            fputs("\\n", fp);
+        else if (ch == '\t')
+            fputs("\\t", fp);
+        else if (ch < 0x20 || ch == 0x7f)
+            fprintf(fp, "\\u%04x", ch);
+        else
+            putc(ch, fp);
+    }
+
+    putc('"', fp);
+}
+
+
+//! Returns the member `name` of `obj`, if it's an object, or `NULL`.
+json_value *find_field(json_value *obj, const char *name)
+{
+    if (!obj || obj->type != json_object)
+        return NULL;
+
+    for (unsigned i = 0; i < obj->u.object.length; ++i)
+        if (!strcmp(obj->u.object.values[i].name, name))
+            return obj->u.object.values[i].value;
+
+    return NULL;
+}
+
+
+////////////
+// Input. //
+////////////
+
+//! Reads a line of any length without the line break.
+bool read_line(FILE *fp, char **buf, size_t *capacity)
+{
+    size_t len = 0;
+
+    if (!*buf)
+        *buf = xmalloc(*capacity = 256);
+
+    while (fgets(*buf + len, *capacity - len, fp))
+    {
+        len += strlen(*buf + len);
+
+        if (len && (*buf)[len - 1] == '\n')
+        {
+            (*buf)[--len] = '\0';
+            return true;
+        }
+
+        *buf = xrealloc(*buf, *capacity *= 2);
+    }
+
+    return len > 0;
+}
+
+
 //////////////
 // Logging. //
 //////////////
@@ -203,7 +473,6 @@ static void print_with_ansi(const char *str, const char *style)
 
 static void print_error(error_t *error)
 {
-    assert(error->line < vec_len(g_lines));
     unsigned line_len, line_from, line_to, line_width;
     char *pointer;
     unsigned pointer_sz;
@@ -217,6 +486,8 @@ static void print_error(error_t *error)
         return;
     }
 
+    assert(error->line < vec_len(g_lines));
+
     line_len = get_line_len(error->line);
     assert(error->column <= line_len);
 
@@ -251,40 +522,334 @@ static void print_error(error_t *error)
     }
 
     fprintf(stderr, "\n");
+    free(pointer);
+}
+
+
+/*!
+ * @name Machine-readable reports.
+ * Errors are written to stdout straight from records as they're printed,
+ * so reports are streamed file by file in both sorted and unsorted modes.
+ */
+//!@{
+enum log_format_e g_log_format = FORMAT_TEXT;
+
+static bool file_reported = false;      //!< `<file>` of checkstyle is open.
+static bool result_reported = false;    //!< Results of SARIF need commas.
+
+#define rule_of(error) ((error)->rule ? (error)->rule : "syntax")
+#define severity_of(error) ((error)->stylistic ? "warning" : "error")
+
+
+static const char *xml_entity(char ch)
+{
+    switch (ch)
+    {
+        case '&':  return "&amp;";
+        case '<':  return "&lt;";
+        case '>':  return "&gt;";
+        case '"':  return "&quot;";
+        case '\'': return "&apos;";
+        default:   return NULL;
+    }
+}
+
+
+static void print_xml_string(FILE *fp, const char *str)
+{
+    for (; *str; ++str)
+        if (xml_entity(*str))
+            fputs(xml_entity(*str), fp);
+        else
+            putc(*str, fp);
+}
+
+
+static void report_error(error_t *error)
+{
+    switch (g_log_format)
+    {
+        case FORMAT_TEXT:
+            print_error(error);
+            break;
+
+        case FORMAT_JSONL:
+            printf("{\"file\": ");
+            print_json_string(stdout, g_filename, strlen(g_filename));
+            printf(", \"line\": %u, \"column\": %u, \"rule\": \"%s\", "
+                   "\"severity\": \"%s\", \"message\": ", error->line + 1,
+                   error->column + 1, rule_of(error), severity_of(error));
+            print_json_string(stdout, error->message, strlen(error->message));
+            printf("}\n");
+            break;
+
+        case FORMAT_SARIF:
+            printf("%s\n        {\"ruleId\": \"%s\", \"level\": \"%s\", "
+                   "\"message\": {\"text\": ", result_reported ? "," : "",
+                   rule_of(error), severity_of(error));
+            print_json_string(stdout, error->message, strlen(error->message));
+            printf("}, \"locations\": [{\"physicalLocation\": "
+                   "{\"artifactLocation\": {\"uri\": ");
+            print_json_string(stdout, g_filename, strlen(g_filename));
+            printf("}, \"region\": {\"startLine\": %u, \"startColumn\": %u}"
+                   "}}]}", error->line + 1, error->column + 1);
+            result_reported = true;
+            break;
+
+        case FORMAT_CHECKSTYLE:
+            if (!file_reported)
+            {
+                printf("  <file name=\"");
+                print_xml_string(stdout, g_filename);
+                printf("\">\n");
+                file_reported = true;
+            }
+
+            printf("    <error line=\"%u\" column=\"%u\" severity=\"%s\" "
+                   "message=\"", error->line + 1, error->column + 1,
+                   severity_of(error));
+            print_xml_string(stdout, error->message);
+            printf("\" source=\"clint.%s\"/>\n", rule_of(error));
+            break;
+    }
+}
+
+
+void start_report(void)
+{
+    switch (g_log_format)
+    {
+        case FORMAT_TEXT:
+        case FORMAT_JSONL:
+            break;
+
+        case FORMAT_SARIF:
+            printf("{\"version\": \"2.1.0\", \"$schema\": "
+                   "\"https://json.schemastore.org/sarif-2.1.0.json\", "
+                   "\"runs\": [\n  {\"tool\": {\"driver\": "
+                   "{\"name\": \"clint\", \"version\": \"%s\"}},\n"
+                   "   \"results\": [", VERSION);
+            break;
+
+        case FORMAT_CHECKSTYLE:
+            printf("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                   "<checkstyle version=\"4.3\">\n");
+            break;
+    }
+}
+
+
+//! Ends errors of the current file.
+void end_file_report(void)
+{
+    if (g_log_format == FORMAT_CHECKSTYLE && file_reported)
+        printf("  </file>\n");
+
+    file_reported = false;
+}
+
+
+void end_report(void)
+{
+    if (g_log_format == FORMAT_SARIF)
+        printf("\n   ]}\n]}\n");
+    else if (g_log_format == FORMAT_CHECKSTYLE)
+        printf("</checkstyle>\n");
+}
+//!@}
+
+
+//! Logs of the current thread are collected here instead of `g_errors`.
+static __thread error_t **collector = NULL;
+
+
+//! Returns the previous collector, which should be restored after.
+error_t **collect_logs(error_t **logs)
+{
+    error_t **prev = collector;
+    collector = logs;
+    return prev;
+}
+
+
+static void push_log(error_t error)
+{
+    if (collector)
+    {
+        if (!*collector)
+            *collector = new_vec(error_t, 2);
+
+        vec_push((*collector), error);
+        return;
+    }
+
+    vec_push(g_errors, error);
+
+    if (!(g_log_mode & (LOG_SORTED|LOG_SILENCE)))
+        report_error(&g_errors[vec_len(g_errors) - 1]);
+}
+
+
+/*!
+ * Messages are stored in blocks, which are released at once, so they aren't
+ * allocated one by one. Threads of the parser log concurrently.
+ */
+static struct messages_s {
+    struct messages_s *prev;
+    size_t size;
+    size_t used;
+    char data[];
+} *messages = NULL;
+
+static bool messages_lock = false;
+
+#define MESSAGES_BLOCK_SIZE (64 << 10)
+
+
+static char *alloc_message(size_t size)
+{
+    char *message;
+
+    while (__atomic_test_and_set(&messages_lock, __ATOMIC_ACQUIRE))
+        sched_yield();
+
+    if (!messages || messages->size - messages->used < size)
+    {
+        size_t capacity = size > MESSAGES_BLOCK_SIZE ? size
+                                                     : MESSAGES_BLOCK_SIZE;
+        struct messages_s *block = xmalloc(sizeof(*block) + capacity);
+
+        block->prev = messages;
+        block->size = capacity;
+        block->used = 0;
+        messages = block;
+    }
+
+    message = messages->data + messages->used;
+    messages->used += size;
+
+    __atomic_clear(&messages_lock, __ATOMIC_RELEASE);
+    return message;
+}
+
+
+static void free_messages(struct messages_s *block)
+{
+    while (block)
+    {
+        struct messages_s *prev = block->prev;
+        free(block);
+        block = prev;
+    }
+}
+
+
+char *copy_message(const char *message)
+{
+    size_t size = strlen(message) + 1;
+    return memcpy(alloc_message(size), message, size);
+}
+
+
+//! Releases all messages, the last block is kept for the next file.
+void release_messages(void)
+{
+    if (!messages)
+        return;
+
+    free_messages(messages->prev);
+    messages->prev = NULL;
+    messages->used = 0;
+
+    if (messages->size > g_spare_limit)
+    {
+        free(messages);
+        messages = NULL;
+    }
+}
+
+
+//! Moves messages of `errors` to new blocks, other messages are released.
+void renew_messages(error_t *errors)
+{
+    struct messages_s *old = messages;
+
+    messages = NULL;
+
+    for (unsigned i = 0; errors && i < vec_len(errors); ++i)
+        errors[i].message = copy_message(errors[i].message);
+
+    free_messages(old);
 }
 
 
 void add_log(bool style, unsigned line, unsigned column, const char *fmt, ...)
 {
     va_list arg;
+    char buffer[256];
     int len;
     char *msg;
 
     if (!(style || g_log_mode & LOG_VERBOSE))
         return;
 
-    if (!g_errors)
-        g_errors = new_vec(error_t, 24);
-
-    if (vec_len(g_errors) >= g_log_limit)
+    if (g_rule && (is_suppressed(line) || is_known(line, fmt)))
         return;
 
+    // The limit is applied by `replay_logs()` for collected logs.
+    if (!collector)
+    {
+        if (!g_errors)
+            g_errors = reuse_vec(g_spare.errors, error_t, 24);
+
+        if (vec_len(g_errors) >= g_log_limit)
+            return;
+    }
+
     va_start(arg, fmt);
-    len = vsnprintf(NULL, 0, fmt, arg);
+    len = vsnprintf(buffer, sizeof(buffer), fmt, arg);
     va_end(arg);
 
     if (len <= 0)
         return;
 
-    msg = xmalloc(len + 1);
-    va_start(arg, fmt);
-    vsnprintf(msg, len + 1, fmt, arg);
-    va_end(arg);
+    msg = alloc_message(len + 1);
 
-    vec_push(g_errors, ((error_t){style, line, column, msg}));
+    // Long messages are formatted again.
+    if (len < sizeof(buffer))
+        memcpy(msg, buffer, len + 1);
+    else
+    {
+        va_start(arg, fmt);
+        vsnprintf(msg, len + 1, fmt, arg);
+        va_end(arg);
+    }
 
-    if (!(g_log_mode & (LOG_SORTED|LOG_SILENCE)))
-        print_error(&g_errors[vec_len(g_errors) - 1]);
+    push_log((error_t){style, line, column, msg, g_rule});
+}
+
+
+void replay_logs(error_t *logs)
+{
+    if (!logs)
+        return;
+
+    if (!g_errors)
+        g_errors = reuse_vec(g_spare.errors, error_t, 24);
+
+    for (unsigned i = 0; i < vec_len(logs); ++i)
+        if (collector || vec_len(g_errors) < g_log_limit)
+            push_log(logs[i]);
+
+    free_vec(logs);
+}
+
+
+//! Messages are kept until `release_messages()`.
+void drop_logs(error_t *logs)
+{
+    if (logs)
+        free_vec(logs);
 }
 
 
@@ -304,5 +869,5 @@ void print_errors_in_order(void)
         (int (*)(const void *, const void *))compare_errors);
 
     for (unsigned i = 0; i < vec_len(g_errors); ++i)
-        print_error(&g_errors[i]);
+        report_error(&g_errors[i]);
 }
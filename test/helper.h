@@ -11,6 +11,12 @@
 extern void test_lexer(void);
 extern void test_parser(void);
 extern void test_rules(void);
+extern void test_diff(void);
+extern void test_shard(void);
+extern void test_baseline(void);
+extern void test_tar(void);
+
+extern FILE *open_text(const char *text);
 
 
 #define group(name) printf("\n> Group %s:\n", name);
@@ -2,10 +2,27 @@
  * @brief Runner of tests.
  */
 
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
 #include "clint.h"
 #include "helper.h"
 
 
+//! Returns the temporary file with `text` to read from the start.
+FILE *open_text(const char *text)
+{
+    FILE *fp = tmpfile();
+
+    assert(fp);
+    fwrite(text, 1, strlen(text), fp);
+    rewind(fp);
+
+    return fp;
+}
+
+
 int main(void)
 {
     g_log_mode |= LOG_SILENCE;
@@ -13,6 +30,10 @@ int main(void)
     test_lexer();
     test_parser();
     test_rules();
+    test_diff();
+    test_shard();
+    test_baseline();
+    test_tar();
 
     return 0;
 }
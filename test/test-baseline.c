@@ -0,0 +1,133 @@
+/*!
+ * @brief Tests for the baseline of known errors.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <json.h>
+
+#include "clint.h"
+#include "helper.h"
+
+
+#define BASELINE_PATH "test/cache/baseline"
+
+
+static unsigned count_errors(const char *filename, const char *data)
+{
+    unsigned count;
+
+    g_filename = xstrdup(filename);
+    g_data = (char *)data;
+    init_parser();
+    parse();
+    check_rules();
+
+    count = g_errors ? vec_len(g_errors) : 0;
+
+    g_data = NULL;
+    reset_state();
+    return count;
+}
+
+
+//! Returns the stored baseline, the size is `vec_len()`.
+static unsigned char *read_baseline(void)
+{
+    FILE *fp = fopen(BASELINE_PATH, "rb");
+    unsigned char *data = new_vec(unsigned char, 256);
+    int ch;
+
+    assert(fp);
+    while ((ch = getc(fp)) != EOF)
+        vec_push(data, ch);
+
+    fclose(fp);
+    return data;
+}
+
+
+static void write_baseline(const unsigned char *data, size_t size)
+{
+    FILE *fp = fopen(BASELINE_PATH, "wb");
+
+    assert(fp);
+    fwrite(data, 1, size, fp);
+    fclose(fp);
+}
+
+
+//! Stores errors of `data` of `filename` as known ones.
+static void update(const char *filename, const char *data, int64_t expected)
+{
+    g_update_baseline = true;
+    assert(load_baseline(BASELINE_PATH));
+    assert(count_errors(filename, data) == 0);
+    assert(store_baseline(BASELINE_PATH) == expected);
+    g_update_baseline = false;
+    assert(load_baseline(BASELINE_PATH));
+}
+
+
+void test_baseline(void)
+{
+    static const unsigned char stored[] = {
+        'C', 'L', 'B', '1', 2, 0, 0, 0,
+        0xbc, 0x6f, 0x32, 0xa7, 0xa7, 0x7e, 0xf6, 0xd4,
+        0x7b, 0x71, 0x35, 0xa7, 0xa7, 0xf6, 0xf9, 0xd4,
+    };
+    json_value *config = g_config;
+    const char *rules = "{ \"lines\": { \"disallow-trailing-space\": true }}";
+    unsigned char *data;
+
+    group("baseline");
+
+    g_config = json_parse(rules, strlen(rules));
+    assert(configure_rules());
+    mkdir("test/cache", 0777);
+
+    // Fingerprints don't depend on runs, so baselines can be committed.
+    test("fingerprints");
+    update("./a.c", "int a; \nint b; \n", 2);
+    data = read_baseline();
+    assert(vec_len(data) == sizeof(stored));
+    assert(!memcmp(data, stored, sizeof(stored)));
+    free_vec(data);
+
+    test("round-trip");
+    assert(count_errors("a.c", "int a; \nint b; \n") == 0);
+    assert(count_errors("b.c", "int a; \nint b; \n") == 2);
+    assert(count_errors("a.c", "int a; \nint c; \n") == 1);
+
+    // Each known error hides one error per file.
+    assert(count_errors("a.c", "int a; \nint a; \n") == 1);
+    assert(count_errors("a.c", "int a; \n") == 0);
+
+    test("moved and reformatted lines");
+    assert(count_errors("a.c", "\n\nint b; \n\nint a; \n") == 0);
+    assert(count_errors("a.c", "int  a; \n\tint b;   \n") == 0);
+    assert(count_errors("a.c", "int ab; \n") == 1);
+
+    test("broken baselines");
+    data = read_baseline();
+
+    // Fingerprints must be sorted.
+    data[15] = 0xff;
+    write_baseline(data, vec_len(data));
+    assert(!load_baseline(BASELINE_PATH));
+    assert(count_errors("a.c", "int a; \n") == 1);
+
+    write_baseline(data, vec_len(data) - 1);
+    assert(!load_baseline(BASELINE_PATH));
+    write_baseline((unsigned char *)"CLB2\0\0\0\0", 8);
+    assert(!load_baseline(BASELINE_PATH));
+    free_vec(data);
+
+    json_value_free(g_config);
+    g_config = config;
+}
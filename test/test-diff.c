@@ -0,0 +1,106 @@
+/*!
+ * @brief Tests for reading diffs.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clint.h"
+#include "helper.h"
+
+
+//! Checks added lines of `diff` as "path:from-to ..." per file.
+static void check(const char *diff, const char *expected)
+{
+    FILE *fp = open_text(diff);
+    changed_t *changed = read_diff(fp, "test.diff");
+    char actual[1024] = "";
+    size_t len = 0;
+
+    fclose(fp);
+    assert(changed);
+
+    for (unsigned i = 0; i < vec_len(changed); ++i)
+    {
+        len += snprintf(actual + len, sizeof(actual) - len, "%s%s:",
+                        i ? "\n" : "", changed[i].path);
+
+        for (unsigned j = 0; j < vec_len(changed[i].ranges); ++j)
+            len += snprintf(actual + len, sizeof(actual) - len, " %u-%u",
+                            changed[i].ranges[j].from,
+                            changed[i].ranges[j].to);
+    }
+
+    if (strcmp(actual, expected))
+    {
+        fprintf(stderr, "Actual:\n%s\nExpected:\n%s\n", actual, expected);
+        assert(0);
+    }
+
+    free_diff(changed);
+}
+
+
+static void check_invalid(const char *diff)
+{
+    FILE *fp = open_text(diff);
+
+    assert(!read_diff(fp, "test.diff"));
+    fclose(fp);
+}
+
+
+void test_diff(void)
+{
+    char path[701], diff[800], expected[720];
+
+    group("diffs");
+
+    // Lines are 0-based, ranges are [from, to).
+    test("added lines");
+    check("diff --git a/x.c b/x.c\n"
+          "--- a/x.c\n"
+          "+++ b/x.c\n"
+          "@@ -1,3 +1,4 @@\n"
+          " int a;\n"
+          "-int b;\n"
+          "+int c;\n"
+          "+int d;\n"
+          " int e;\n"
+          "@@ -10,2 +11,2 @@ void f()\n"
+          "\n"
+          "-int f;\n"
+          "+int g;\n",
+          "x.c: 1-3 11-12");
+    check("--- a/x.c\n+++ b/x.c\n@@ -1 +1 @@\n-int a;\n+int b;\n"
+          "\\ No newline at end of file\n",
+          "x.c: 0-1");
+
+    test("new and removed files");
+    check("--- /dev/null\n+++ b/new.c\n@@ -0,0 +1,2 @@\n+int a;\n+int b;\n"
+          "--- a/old.c\n+++ /dev/null\n@@ -1 +0,0 @@\n-int a;\n",
+          "new.c: 0-2");
+
+    // Diffs w/o prefixes keep paths as is.
+    test("paths");
+    check("--- x.c\t2024-01-01\n+++ b/x.c\t2024-01-02\n@@ -1 +1 @@\n-a\n+b\n",
+          "b/x.c: 0-1");
+    check("--- a/x.c\n+++ b/x.c\n@@ -1 +1 @@\n-a\n+b\n"
+          "--- a/y.c\n+++ b/y.c\n@@ -5,0 +6 @@\n+c\n",
+          "x.c: 0-1\ny.c: 5-6");
+
+    // Lines are read regardless of their length.
+    test("long lines");
+    memset(path, 'p', 700);
+    path[700] = '\0';
+    snprintf(diff, sizeof(diff), "--- a/x.c\n+++ b/%s\n@@ -1 +1 @@\n-a\n+b\n",
+             path);
+    snprintf(expected, sizeof(expected), "%s: 0-1", path);
+    check(diff, expected);
+
+    test("invalid hunks");
+    check_invalid("--- a/x.c\n+++ b/x.c\n@@ -a +1 @@\n+b\n");
+    check_invalid("--- a/x.c\n+++ b/x.c\n@@ -1 1 @@\n+b\n");
+}
@@ -99,6 +99,7 @@ void test_lexer(void)
 #define XX(kind, str)                                                         \
     assert(check(str, ((v_t){kind})));
 
+    // Every keyword is looked up, so collisions of the hash fail here.
     test("keywords");
     {
         assert(check("i", ((v_t){TOK_IDENTIFIER})));
@@ -283,5 +284,74 @@ void test_lexer(void)
             ((v_t){TOK_NUM_CONST, PN_PLUS, TOK_NUM_CONST})));
         assert(check("1+ \\\r\n\\\r\n\\\r\n 2",
             ((v_t){TOK_NUM_CONST, PN_PLUS, TOK_NUM_CONST})));
+        assert(check("\\\n1+ \\\n 2",
+            ((v_t){TOK_UNKNOWN, TOK_NUM_CONST, PN_PLUS, TOK_NUM_CONST})));
+        assert(check("\"a\\ b\" \\ x",
+            ((v_t){TOK_STRING, TOK_IDENTIFIER})));
+    }
+
+    test("long lexemes");
+    {
+        assert(check("                                                   a",
+            ((v_t){TOK_IDENTIFIER})));
+        assert(check("\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t  \t\t  a",
+            ((v_t){TOK_IDENTIFIER})));
+        assert(check("\"0123456789abcdef0123456789abcdef0123456789abcdef\"",
+            ((v_t){TOK_STRING})));
+        assert(check("\"0123456789abcdef0123456789abcdef\\\"0123456789abc\"",
+            ((v_t){TOK_STRING})));
+        assert(check("\"0123456789abcdef0123456789abcdef0123456789abcdef",
+            ((v_t){TOK_UNKNOWN})));
+        assert(check("\"0123456789abcdef0123456789abcdef01234567\n89\" a",
+            ((v_t){TOK_UNKNOWN, TOK_NUM_CONST, TOK_UNKNOWN})));
+        assert(check("'0123456789abcdef0123456789abcdef0123456789abcdef'",
+            ((v_t){TOK_CHAR_CONST})));
+        assert(check("/* 0123456789abcdef0123456789abcdef * 0123456789 **/",
+            ((v_t){TOK_COMMENT})));
+        assert(check("/* 0123456789abcdef0123456789abcdef\n0123456789 */ a",
+            ((v_t){TOK_COMMENT, TOK_IDENTIFIER})));
+        assert(check("/* 0123456789abcdef0123456789abcdef0123456789abcdef",
+            ((v_t){TOK_UNKNOWN})));
+        assert(check("// 0123456789abcdef0123456789abcdef0123456789\\\n a",
+            ((v_t){TOK_COMMENT})));
+        assert(check("// 0123456789abcdef0123456789abcdef0123456789\n a",
+            ((v_t){TOK_COMMENT, TOK_IDENTIFIER})));
+    }
+    test("atoms");
+    {
+        token_t tok;
+        atom_t atom = intern("foo_Bar1", 8);
+
+        assert(atom && atom == intern("foo_Bar1", 8));
+        assert(atom != intern("foo_Bar", 7));
+        assert(!strcmp(atom_name(atom), "foo_Bar1"));
+        assert(atom_length(atom) == 8);
+        assert(atom_shape(atom) == (SHAPE_UPPER|SHAPE_DIGIT));
+        assert(atom_shape(intern("_x", 2)) == SHAPE_UNDERSCORE);
+
+        g_data = xstrdup("int foo_Bar1");
+        init_lexer();
+        pull_token(&tok);
+        assert(tok.kind == KW_INT && !tok.atom);
+        pull_token(&tok);
+        assert(tok.kind == TOK_IDENTIFIER && tok.atom == atom);
+        reset_state();
+    }
+    test("opt-out markers");
+    {
+        const char *markers[] = {"generated", "clint: off", NULL};
+
+#define marked(data) has_marker(data, strlen(data), markers)
+        assert(marked("// clint: off\nint a;"));
+        assert(marked("int a; /* generated by foo */"));
+        assert(marked("/* cut off at the end: generated"));
+        assert(marked("// spliced \\\n clint: off"));
+        assert(!marked("const char *s = \"clint: off\";"));
+        assert(!marked("char c = '\"'; s = \"// clint: off\";"));
+        assert(!marked("s = \"\\\" /* generated */\";"));
+        assert(!marked("// clint:\n off"));
+        assert(!marked("int generated;"));
+#undef marked
+        assert(!has_marker("/* clint: off */", 8, markers));
     }
 }
@@ -4,6 +4,7 @@
 
 #include <assert.h>
 #include <ctype.h>
+#include <dirent.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -14,7 +15,7 @@
 #include "tree.h"
 
 
-static bool check(bool full, char *input, const char *expected)
+static bool check_mode(bool full, char *input, const char *expected)
 {
     static char buffer[2048];
     char *actual;
@@ -27,8 +28,13 @@ static bool check(bool full, char *input, const char *expected)
         g_data = buffer;
     }
 
-    init_parser();
-    parse();
+    if (g_cache_dir)
+        parse_cached();
+    else
+    {
+        init_parser();
+        parse();
+    }
 
     if (full)
         actual = stringify_tree();
@@ -64,10 +70,60 @@ static bool check(bool full, char *input, const char *expected)
 }
 
 
-static void parse_tasks(char *data)
+static bool check(bool full, char *input, const char *expected)
+{
+    bool success;
+
+    g_pipelined = false;
+    success = check_mode(full, input, expected);
+
+    g_pipelined = true;
+    success = success && check_mode(full, input, expected);
+
+    g_pipelined = false;
+
+    // The tree is stored first, then it's mapped.
+    g_cache_dir = "test/cache";
+    success = success && check_mode(full, input, expected) &&
+              check_mode(full, input, expected);
+
+    g_cache_dir = NULL;
+    return success;
+}
+
+
+//! Returns the section after the separator at `*data`, which ends by "~~~".
+static char *take_section(char **data)
+{
+    char *section = strchr(*data, '\n');
+
+    assert(section && "Expected section.");
+    ++section;
+
+    *data = strstr(section, "\n~~~");
+    assert(*data && "Expected separator.");
+    *((*data)++) = '\0';
+    *data = strchr(*data, '\n');
+
+    return section;
+}
+
+
+//! Checks the sections of a test, the first one is code.
+typedef bool (*checker_t)(bool full, char **sections);
+
+
+static bool check_tree(bool full, char **sections)
+{
+    return check(full, sections[0], sections[1]);
+}
+
+
+//! Runs tests of `data` with `count` sections each (the code and results).
+static void parse_tasks(char *data, unsigned count, checker_t checker)
 {
     static char *group_name, *test_name;
-    static char *code, *tree;
+    static char *sections[4];
     static bool is_full;
 
 #define skip_spaces() while (isspace(*data)) ++data
@@ -78,7 +134,7 @@ static void parse_tasks(char *data)
         =========
         code
         ~~~~~~~~~
-        tree
+        tree (or more results)
         ~~~~~~~~~
      */
     for (;;)
@@ -121,35 +177,219 @@ static void parse_tasks(char *data)
             test(test_name);
 
             assert(*data == '=' && "Expected separator.");
-            data = strchr(data, '\n');
-            assert(data && "Expected code section.");
-            code = ++data;
+            assert(count <= 4);
+            for (unsigned i = 0; i < count; ++i)
+                sections[i] = take_section(&data);
 
-            data = strstr(data, "\n~~~");
-            assert(data && "Expected separator.");
-            *(data++) = '\0';
+            assert(checker(is_full, sections));
+        }
+    }
+}
 
-            data = strchr(data, '\n');
-            assert(data && "Expected tree section.");
-            tree = ++data;
 
-            data = strstr(data, "\n~~~");
-            assert(data && "Expected separator.");
-            *(data++) = '\0';
-            data = strchr(data, '\n');
+//! Returns the content of the only entry in `g_cache_dir`.
+static char *read_entry(char *path, size_t path_size, size_t *size)
+{
+    DIR *dir = opendir(g_cache_dir);
+    struct dirent *entry;
+    FILE *fp;
+    char *data;
+
+    assert(dir);
+
+    while ((entry = readdir(dir)) && entry->d_name[0] == '.')
+        continue;
+
+    assert(entry);
+    snprintf(path, path_size, "%s/%s", g_cache_dir, entry->d_name);
+    closedir(dir);
+
+    fp = fopen(path, "rb");
+    assert(fp);
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+
+    data = xmalloc(*size);
+    fread(data, 1, *size, fp);
+    fclose(fp);
+    return data;
+}
+
+
+static char *parse_tree(char *input)
+{
+    char *tree;
+
+    g_data = input;
+
+    if (g_cache_dir)
+        parse_cached();
+    else
+    {
+        init_parser();
+        parse();
+    }
+
+    tree = stringify_tree();
+
+    g_data = NULL;
+    reset_state();
+    return tree;
+}
 
-            assert(check(is_full, code, tree));
+
+/*!
+ * Words of the entry are broken one by one to point after its end, then
+ * the entry must be parsed again instead of reading out of the mapping.
+ */
+static void test_broken_cache(void)
+{
+    static char input[] = "typedef int T;\n"
+                          "void f(T x) {\n"
+                          "    if (x) { g(x, \"s\"); } else return;\n"
+                          "    int = ;\n"
+                          "}\n";
+    char path[256], *expected, *entry, *broken;
+    size_t size;
+
+    group("cache");
+    test("broken entries");
+
+    expected = parse_tree(input);
+
+    g_cache_dir = "test/cache/broken";
+    free(parse_tree(input));
+    entry = read_entry(path, sizeof(path), &size);
+    broken = xmalloc(size);
+
+    for (size_t i = 0; i + sizeof(size_t) <= size; i += sizeof(size_t))
+    {
+        FILE *fp = fopen(path, "wb");
+        char *actual;
+
+        memcpy(broken, entry, size);
+        memcpy(broken + i, &size, sizeof(size));
+
+        assert(fp);
+        fwrite(broken, 1, size, fp);
+        fclose(fp);
+
+        actual = parse_tree(input);
+        assert(!strcmp(actual, expected));
+        free(actual);
+    }
+
+    g_cache_dir = NULL;
+    free(expected);
+    free(entry);
+    free(broken);
+}
+
+
+//! Returns what `dump` writes, the size is `vec_len()`.
+static char *take_dump(void (*dump)(FILE *, enum dump_e), enum dump_e format)
+{
+    FILE *fp = tmpfile();
+    char *result;
+    size_t size;
+
+    assert(fp);
+    dump(fp, format);
+
+    size = ftell(fp);
+    rewind(fp);
+    result = new_vec(char, size + 1);
+    vec_len(result) = fread(result, 1, size, fp);
+    result[vec_len(result)] = '\0';
+    fclose(fp);
+
+    return result;
+}
+
+
+//! Appends bytes of `dump` in hex, whitespace isn't written.
+static char *append_hex(char *hex, const char *dump)
+{
+    static const char digits[] = "0123456789abcdef";
+
+    for (unsigned i = 0; i < vec_len(dump); ++i)
+    {
+        vec_push(hex, digits[(unsigned char)dump[i] >> 4]);
+        vec_push(hex, digits[(unsigned char)dump[i] & 0xf]);
+    }
+
+    return hex;
+}
+
+
+//! Dumps tokens, then the tree, in JSON Lines and in binary.
+static bool check_dumps(bool full, char **sections)
+{
+    char *jsonl, *hex, *expected = sections[2], *dump;
+    unsigned len = 0;
+    bool success;
+
+    jsonl = new_vec(char, 1024);
+    hex = new_vec(char, 1024);
+
+    for (int tree = 0; tree < 2; ++tree)
+    {
+        g_data = sections[0];
+        g_filename = xstrdup("a.c");
+
+        if (tree)
+        {
+            init_parser();
+            parse();
+        }
+        else
+        {
+            init_lexer();
+            tokenize();
         }
+
+        dump = take_dump(tree ? dump_tree : dump_tokens, DUMP_JSONL);
+        for (unsigned i = 0; i < vec_len(dump); ++i)
+            vec_push(jsonl, dump[i]);
+        free_vec(dump);
+
+        dump = take_dump(tree ? dump_tree : dump_tokens, DUMP_BINARY);
+        hex = append_hex(hex, dump);
+        free_vec(dump);
+
+        g_data = NULL;
+        reset_state();
     }
+
+    // The section doesn't include the last newline.
+    vec_len(jsonl) -= vec_len(jsonl) > 0;
+    vec_push(jsonl, '\0');
+    vec_push(hex, '\0');
+
+    // Bytes are grouped by lines and spaces in tests.
+    for (char *ptr = expected; *ptr; ++ptr)
+        if (!isspace(*ptr))
+            expected[len++] = *ptr;
+
+    expected[len] = '\0';
+    success = !strcmp(jsonl, sections[1]) && !strcmp(hex, expected);
+
+    if (!success)
+        fprintf(stderr, "Actual dumps:\n%s\n%s\n", jsonl, hex);
+
+    free_vec(jsonl);
+    free_vec(hex);
+    return success;
 }
 
 
-void test_parser(void)
+static void run_tasks(const char *path, unsigned count, checker_t checker)
 {
     size_t size;
     char *data;
 
-    FILE *fp = fopen("test/test-parser.txt", "r");
+    FILE *fp = fopen(path, "r");
     assert(fp);
 
     // Determine the size.
@@ -163,7 +403,15 @@ void test_parser(void)
     fclose(fp);
 
     data[size] = '\0';
-    parse_tasks(data);
+    parse_tasks(data, count, checker);
 
     free(data);
 }
+
+
+void test_parser(void)
+{
+    run_tasks("test/test-parser.txt", 2, check_tree);
+    test_broken_cache();
+    run_tasks("test/test-dump.txt", 3, check_dumps);
+}
@@ -5,7 +5,9 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <json.h>
 
@@ -24,27 +26,26 @@ static void setup(const char *config)
 }
 
 
-static void check(const char *input, bool full, int expected)
+static void check_mode(const char *data, bool by_parts, int expected)
 {
-    static char buffer[512];
     int actual;
 
-    if (full)
-        g_data = (char *)input;
+    g_data = (char *)data;
+    init_parser();
+
+    if (by_parts)
+        check_by_parts();
     else
     {
-        snprintf(buffer, sizeof(buffer), "void test() {\n%s\n}", input);
-        g_data = buffer;
+        parse();
+        check_rules();
     }
 
-    init_parser();
-    parse();
-    check_rules();
-
     actual = g_errors ? vec_len(g_errors) : 0;
     if (expected != actual)
     {
-        fprintf(stderr, "Expected (%d) != actual (%d).\n", expected, actual);
+        fprintf(stderr, "Expected (%d) != actual (%d)%s.\n", expected, actual,
+                by_parts ? " by parts" : "");
 
         for (int i = 0; i < actual; ++i)
             fprintf(stderr, "  - %s (%u:%u)\n", g_errors[i].message,
@@ -58,6 +59,22 @@ static void check(const char *input, bool full, int expected)
 }
 
 
+static void check(const char *input, bool full, int expected)
+{
+    static char buffer[512];
+    const char *data = input;
+
+    if (!full)
+    {
+        snprintf(buffer, sizeof(buffer), "void test() {\n%s\n}", input);
+        data = buffer;
+    }
+
+    check_mode(data, false, expected);
+    check_mode(data, true, expected);
+}
+
+
 static void test_block(void)
 {
     group("block rules");
@@ -99,6 +116,7 @@ static void test_block(void)
                          "\"allow-before-decls\": [\"assert\"] }}");
     check("void foo() { assert(); int a; b; }", true, 0);
     check("void foo() { assert(); b; int a; }", true, 1);
+    check("void foo() { ass(); int a; }", true, 1);
 }
 
 
@@ -278,6 +296,7 @@ static void test_runtime(void)
     test("require-safe-fn");
     setup("{ \"runtime\": { \"require-safe-fn\": true }}");
     check("gets();", false, 1);
+    check("very_long_function_name();", false, 0);
 
     test("require-sized-int");
     setup("{ \"runtime\": { \"require-sized-int\": true }}");
@@ -545,6 +564,605 @@ static void test_whitespace(void)
 }
 
 
+static void check_changes_of(const char *before, const char *after,
+                             bool reused, int expected)
+{
+    int actual;
+
+    g_data = xstrdup(before);
+    init_parser();
+    parse();
+    check_rules();
+
+    assert(check_changes(xstrdup(after)) == reused);
+
+    actual = g_errors ? vec_len(g_errors) : 0;
+    if (expected != actual)
+    {
+        fprintf(stderr, "Expected (%d) != actual (%d) after changes.\n",
+                expected, actual);
+
+        for (int i = 0; i < actual; ++i)
+            fprintf(stderr, "  - %s (%u:%u)\n", g_errors[i].message,
+                g_errors[i].line + 1, g_errors[i].column + 1);
+
+        assert(0);
+    }
+
+    reset_state();
+}
+
+
+static void test_changes(void)
+{
+    group("incremental checking");
+
+    setup("{ \"lines\": { \"maximum-length\": 20 }}");
+
+    test("reused entities");
+    check_changes_of("int a;\nint b;\nint c;", "int a;\nint bc;\nint c;",
+                     true, 0);
+    check_changes_of("int a;\nint b;\nint c;",
+                     "int a;\nint b = 100000000000000;\nint c;", true, 1);
+    check_changes_of("int a = 100000000000000;\nint b;\nint c = 1;",
+                     "int a = 100000000000000;\n\nint b;\nint c = 1;",
+                     true, 1);
+    check_changes_of("int a;\nint b;\nint c = 100000000000000;",
+                     "int a;\nint c = 100000000000000;", true, 1);
+
+    test("checked again");
+    check_changes_of("int a;\nint b;", "int a;\nint b", false, 0);
+    check_changes_of("int a;\nint b", "int a = 100000000000000;\nint b;",
+                     false, 1);
+    check_changes_of("typedef int T;\nT b;\nint c = 100000000000000;",
+                     "typedef int U;\nT b;\nint c = 100000000000000;",
+                     false, 1);
+}
+
+
+//! Builds `head`, `count` times `piece`, `tail` (must be freed).
+static char *repeat(const char *head, const char *piece, unsigned count,
+                    const char *tail)
+{
+    size_t head_len = strlen(head), piece_len = strlen(piece);
+    char *data = xmalloc(head_len + piece_len * count + strlen(tail) + 1);
+    char *ptr = data + head_len;
+
+    memcpy(data, head, head_len);
+
+    for (unsigned i = 0; i < count; ++i, ptr += piece_len)
+        memcpy(ptr, piece, piece_len);
+
+    memcpy(ptr, tail, strlen(tail) + 1);
+    return data;
+}
+
+
+static void check_nesting(char *data, int expected)
+{
+    check_mode(data, false, expected);
+    check_mode(data, true, expected);
+    free(data);
+}
+
+
+static void test_nesting(void)
+{
+    char *tail;
+
+    group("deep nesting");
+
+    setup("{}");
+    g_log_mode |= LOG_VERBOSE;
+
+    test("long chains");
+    check_nesting(repeat("void f() {\nif (a) a;\n", "else if (a) a;\n",
+                         100000, "}"), 0);
+    check_nesting(repeat("void f() {\nswitch (a) {\n", "case 1:\n",
+                         100000, "a;\n}\n}"), 0);
+    check_nesting(repeat("int a = ", "a ? a : ", 100000, "a;"), 0);
+    check_nesting(repeat("void f() {\n", "a = ", 100000, "a;\n}"), 0);
+    check_nesting(repeat("int a = ", "a + ", 100000, "a;"), 0);
+
+    test("too deep nesting");
+    tail = repeat("a", ")", 100000, ";\nint b;");
+    check_nesting(repeat("int a = ", "(", 100000, tail), 1);
+    free(tail);
+    tail = repeat("", "}\n", 100000, "}\nint b;");
+    check_nesting(repeat("void f() {\n", "{\n", 100000, tail), 1);
+    free(tail);
+    check_nesting(repeat("int a = ", "-", 100000, "a;"), 1);
+
+    test("max-depth");
+    g_max_depth = 3;
+    check_nesting(repeat("int a = ", "(", 2, "a));"), 0);
+    check_nesting(repeat("int a = ", "(", 3, "a)));"), 1);
+    g_max_depth = 256;
+
+    g_log_mode &= ~LOG_VERBOSE;
+}
+
+
+static void test_recovery(void)
+{
+    char *data;
+
+    group("recovery");
+
+    setup("{}");
+    g_log_mode |= LOG_VERBOSE;
+
+    // Far more than 1024 recoveries, which used to cut the file off.
+    test("many errors");
+    data = repeat("", "int = ;\n", 2000,
+                  "int f(void) { return 1 }\nint g(void) { return 1 }\n");
+    check_mode(data, false, 2002);
+    check_mode(data, true, 2002);
+    free(data);
+
+    g_log_mode &= ~LOG_VERBOSE;
+}
+
+
+static int compare_errors(const void *a, const void *b)
+{
+    const error_t *x = a, *y = b;
+
+    if (x->line != y->line)
+        return x->line < y->line ? -1 : 1;
+
+    if (x->column != y->column)
+        return x->column < y->column ? -1 : 1;
+
+    return strcmp(x->message, y->message);
+}
+
+
+//! Returns sorted errors of `data` checked at once or by parts.
+static error_t *collect_errors(char *data, bool by_parts)
+{
+    error_t *errors;
+
+    g_data = data;
+    init_parser();
+
+    if (by_parts)
+    {
+        check_by_parts();
+        assert(g_part.lines_from > 0);
+    }
+    else
+    {
+        parse();
+        check_rules();
+    }
+
+    assert(g_errors);
+    errors = copy_vec(g_errors, xmalloc(vec_size(g_errors)));
+
+    for (unsigned i = 0; i < vec_len(errors); ++i)
+        errors[i].message = xstrdup(errors[i].message);
+
+    qsort(errors, vec_len(errors), sizeof(error_t), compare_errors);
+
+    g_data = NULL;
+    reset_state();
+    return errors;
+}
+
+
+//! Checks that both collections of errors are the same and frees them.
+static void check_same_errors(error_t *expected, error_t *actual)
+{
+    assert(vec_len(expected) == vec_len(actual));
+
+    for (unsigned i = 0; i < vec_len(expected); ++i)
+    {
+        assert(!compare_errors(&expected[i], &actual[i]));
+        free(expected[i].message);
+        free(actual[i].message);
+    }
+
+    free_vec(expected);
+    free_vec(actual);
+}
+
+
+//! Checks that errors are the same as of the serial mode w/o parts.
+static void check_modes_of(char *data, bool by_parts, unsigned jobs)
+{
+    error_t *serial = collect_errors(data, false), *other;
+
+    g_jobs = jobs;
+    other = collect_errors(data, by_parts);
+    g_jobs = 1;
+
+    check_same_errors(serial, other);
+    free(data);
+}
+
+
+static void test_parts(void)
+{
+    group("checking by parts");
+
+    setup("{ \"naming\": { \"typedef-suffix\": \"_t\", "
+                         "\"minimum-length\": 2 },"
+          "  \"lines\": { \"maximum-length\": 40, "
+                         "\"disallow-trailing-space\": true },"
+          "  \"indentation\": { \"size\": 4 },"
+          "  \"whitespace\": { \"before-semicolon\": false, "
+                              "\"newline-before-fn-body\": true },"
+          "  \"block\": { \"disallow-short\": true, "
+                         "\"require-decls-on-top\": true },"
+          "  \"runtime\": { \"require-safe-fn\": true }}");
+
+    // Many parts of `PART_SIZE` tokens, errors are at their boundaries too.
+    test("same errors as at once");
+    check_modes_of(repeat("", "typedef int T;\n"
+                              "static T f(T *x) {\n"
+                              "  if (x) { return *x ; }\n"
+                              "    g();\n"
+                              "    int y = sprintf(buf, \"%d\", 1);  \n"
+                              "    return y + 100000000000000000000;\n"
+                              "}\n", 1000, ""), true, 1);
+}
+
+
+static void test_jobs(void)
+{
+    group("parsing in parallel");
+
+    setup("{ \"naming\": { \"minimum-length\": 2 }}");
+    g_log_mode |= LOG_VERBOSE;
+
+    // Chunks of `CHUNK_SIZE` tokens, the serial mode is the fallback.
+    test("same errors as serially");
+    check_modes_of(repeat("", "int f(int x) { return x + 1; }\n", 2000, ""),
+                   false, 4);
+    check_modes_of(repeat("int = ;\n", "int f(int x) { return x; }\n", 2000,
+                          ""), false, 4);
+    check_modes_of(repeat("", "int f(int x) { return x; }\n", 2000,
+                          "void g(void) { if (1) { x = "), false, 4);
+
+    g_log_mode &= ~LOG_VERBOSE;
+}
+
+
+//! Checks `files` one by one in the reused buffers and w/o spares at all.
+static void check_reuse_of(char **files, unsigned count)
+{
+    error_t *expected[8];
+    size_t limit = g_spare_limit, capacity = 0;
+    char *prev = NULL, *buffer;
+
+    assert(count <= 8);
+
+    g_spare_limit = 0;
+    for (unsigned i = 0; i < count; ++i)
+        expected[i] = collect_errors(files[i], false);
+
+    assert(!g_spare.lines && !g_spare.tokens && !g_spare.errors);
+    g_spare_limit = limit;
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        size_t size = strlen(files[i]) + 1;
+
+        buffer = alloc_data(size);
+        memcpy(buffer, files[i], size);
+
+        // A smaller file takes the same buffer.
+        if (size <= capacity)
+            assert(buffer == prev);
+        else
+            capacity = size;
+
+        check_same_errors(expected[i], collect_errors(buffer, i % 2));
+        assert(g_spare.lines && g_spare.tokens && g_spare.errors);
+
+        prev = buffer;
+        free(files[i]);
+    }
+}
+
+
+static void test_reuse(void)
+{
+    const char *piece = "typedef int T;\n"
+                        "static T f(T *x) {\n"
+                        "  if (x) { return *x ; }\n"
+                        "  int y = sprintf(buf, \"%d\", 1);  \n"
+                        "}\n"
+                        "int = ;\n";
+    char *files[5];
+
+    group("reuse of buffers");
+
+    setup("{ \"naming\": { \"typedef-suffix\": \"_t\" },"
+          "  \"lines\": { \"disallow-trailing-space\": true },"
+          "  \"whitespace\": { \"before-semicolon\": false },"
+          "  \"runtime\": { \"require-safe-fn\": true }}");
+    g_log_mode |= LOG_VERBOSE;
+
+    // Leftovers of a larger file must not leak into the smaller one.
+    test("same errors as in new buffers");
+    files[0] = repeat("", piece, 2000, "");
+    files[1] = repeat("", piece, 500, "");
+    files[2] = repeat("", piece, 3, "");
+    files[3] = repeat("", piece, 1000, "");
+    files[4] = repeat("", piece, 4000, "void g(void) { if (1) { x = ");
+    check_reuse_of(files, 5);
+
+    g_log_mode &= ~LOG_VERBOSE;
+}
+
+
+static void test_messages(void)
+{
+    char config[1024], prefix[601], *data;
+    size_t len = 600 + strlen("Required \"\" prefix");
+    error_t *errors;
+
+    group("messages");
+
+    // Messages longer than the buffer of `add_log()` are formatted again.
+    test("long messages");
+    memset(prefix, 'p', 600);
+    prefix[600] = '\0';
+    snprintf(config, sizeof(config),
+             "{ \"naming\": { \"global-var-prefix\": \"%s\" }}", prefix);
+    setup(config);
+
+    data = repeat("", "int x;\n", 2, "");
+    errors = collect_errors(data, false);
+    assert(vec_len(errors) == 2);
+
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        assert(strlen(errors[i].message) == len);
+        assert(strstr(errors[i].message, prefix));
+        free(errors[i].message);
+    }
+
+    free_vec(errors);
+    free(data);
+
+    // Messages of a file fill more than one block.
+    test("many messages");
+    setup("{ \"naming\": { \"global-var-prefix\": \"g_\" }}");
+    data = repeat("", "int x;\n", 5000, "");
+    errors = collect_errors(data, false);
+    assert(vec_len(errors) == 5000);
+
+    for (unsigned i = 0; i < 5000; ++i)
+    {
+        assert(!strcmp(errors[i].message, "Required \"g_\" prefix"));
+        free(errors[i].message);
+    }
+
+    free_vec(errors);
+    free(data);
+}
+
+
+static bool interrupt(void)
+{
+    return true;
+}
+
+
+static bool never_interrupt(void)
+{
+    return false;
+}
+
+
+//! Starts the timer of `timeout` ms and waits for a bit longer.
+static void start_expired_timer(unsigned timeout)
+{
+    struct timespec pause = {0, (timeout + 2) * 1000000L};
+
+    g_file_timeout = timeout;
+    start_timer();
+    nanosleep(&pause, NULL);
+}
+
+
+//! Polls `timed_out()` `count` times, returns how many times it was true.
+static unsigned count_timeouts(unsigned count)
+{
+    unsigned timeouts = 0;
+
+    for (unsigned i = 0; i < count; ++i)
+        timeouts += timed_out();
+
+    return timeouts;
+}
+
+
+static void test_cutoff(void)
+{
+    char *data;
+
+    group("cut off files");
+
+    setup("{ \"naming\": { \"global-var-prefix\": \"g_\" }}");
+    data = repeat("", "int x;\n", 5000, "");
+
+    test("interrupted checks");
+    g_interrupter = never_interrupt;
+    check_mode(data, false, 5000);
+
+    g_interrupter = interrupt;
+    g_data = data;
+    start_timer();
+    init_parser();
+    parse();
+    check_rules();
+    assert(timed_out());
+    assert(!g_errors || vec_len(g_errors) < 5000);
+    g_data = NULL;
+    reset_state();
+
+    test("interrupted changes");
+    g_interrupter = NULL;
+    g_data = xstrdup(data);
+    init_parser();
+    parse();
+    check_rules();
+    assert(!timed_out());
+
+    g_interrupter = interrupt;
+    start_timer();
+    check_changes(repeat("int y;\n", "int x;\n", 5000, ""));
+    assert(timed_out());
+    assert(!g_errors || vec_len(g_errors) < 5001);
+    reset_state();
+
+    g_interrupter = NULL;
+
+    // The clock is read once per 256 polls, then it's out for the file.
+    test("file timeout");
+    start_expired_timer(0);
+    assert(!count_timeouts(1024));
+
+    g_file_timeout = 60000;
+    start_timer();
+    assert(!count_timeouts(1024));
+
+    start_expired_timer(1);
+    assert(count_timeouts(1024) > 1024 - 256);
+    assert(count_timeouts(1024) == 1024);
+
+    reset_state();
+    assert(!count_timeouts(1024));
+
+    start_expired_timer(1);
+    g_data = data;
+    init_parser();
+    parse();
+    check_rules();
+    assert(timed_out());
+    assert(!g_errors || vec_len(g_errors) < 5000);
+    g_data = NULL;
+    reset_state();
+
+    g_file_timeout = 0;
+    free(data);
+}
+
+
+static void check_rule_of(const char *data, const char *rule)
+{
+    g_data = (char *)data;
+    init_parser();
+    parse();
+    check_rules();
+
+    assert(g_errors && vec_len(g_errors) == 1);
+    assert(rule ? g_errors[0].rule && !strcmp(g_errors[0].rule, rule)
+                : !g_errors[0].rule);
+
+    g_data = NULL;
+    reset_state();
+}
+
+
+static void test_names(void)
+{
+    group("names of rules");
+
+    setup("{ \"lines\": { \"maximum-length\": 20 }}");
+    g_log_mode |= LOG_VERBOSE;
+
+    test("errors of rules");
+    check_rule_of("void t() { int abc; }", "lines");
+
+    test("syntax errors");
+    check_rule_of("int a", NULL);
+
+    g_log_mode &= ~LOG_VERBOSE;
+}
+
+
+static void test_suppressions(void)
+{
+    group("suppressions");
+
+    setup("{ \"lines\": { \"disallow-trailing-space\": true }}");
+
+    test("clint-disable-next-line");
+    check("// clint-disable-next-line\nint a; \nint b; ", true, 1);
+    check("// clint-disable-next-line lines\nint a; ", true, 0);
+    check("// clint-disable-next-line naming\nint a; ", true, 1);
+    check("/* clint-disable-next-line naming, lines */\nint a; ", true, 0);
+    check("// clint-disable-next-line lines -- why\nint a; ", true, 0);
+
+    test("clint-disable and clint-enable");
+    check("/* clint-disable */\nint a; \nint b; \n// clint-enable\nint c; ",
+          true, 1);
+    check("/* clint-disable lines */\nint a; \nint b; ", true, 0);
+    check("// clint-disable lines\n// clint-disable-next-line lines\n"
+          "int a; \n// clint-enable lines\nint b; ", true, 1);
+    check("// clint-disable naming\nint a; ", true, 1);
+
+    test("unknown rules");
+    check("// clint-disable-next-line linez\nint a;", true, 1);
+    check("// clint-disabled\nint a; ", true, 1);
+
+    // Only unknown names suppress nothing, unlike no names at all.
+    check("// clint-disable-next-line linez\nint a; ", true, 2);
+    check("// clint-disable linez, namez\nint a; \nint b; ", true, 4);
+    check("// clint-disable-next-line lines, linez\nint a; ", true, 1);
+}
+
+
+static void check_ranges_of(const char *data, unsigned from, unsigned to,
+                            int expected)
+{
+    range_t *ranges = new_vec(range_t, 1);
+    int actual;
+
+    vec_push(ranges, ((range_t){from, to}));
+
+    g_data = (char *)data;
+    init_parser();
+    parse();
+    check_ranges(ranges);
+
+    actual = g_errors ? vec_len(g_errors) : 0;
+    if (expected != actual)
+    {
+        fprintf(stderr, "Expected (%d) != actual (%d) at [%u, %u).\n",
+                expected, actual, from, to);
+        assert(0);
+    }
+
+    g_data = NULL;
+    reset_state();
+    free_vec(ranges);
+}
+
+
+static void test_ranges(void)
+{
+    group("ranges");
+
+    test("lines");
+    setup("{ \"lines\": { \"disallow-trailing-space\": true }}");
+    check_ranges_of("int a; \nint b; \nint c; ", 1, 2, 1);
+    check_ranges_of("int a; \nint b; \nint c; ", 1, 3, 2);
+    check_ranges_of("int a; \nint b; \nint c; ", 3, 4, 0);
+
+    test("entities");
+    setup("{ \"indentation\": { \"size\": 4 }}");
+    check_ranges_of("void f() {\n  a;\n    b;\n}", 2, 3, 0);
+    check_ranges_of("void f() {\n  a;\n    b;\n}", 1, 2, 1);
+    check_ranges_of("void f() {\n  a;\n}\nvoid g() {\n  b;\n}", 4, 5, 1);
+}
+
+
 void test_rules(void)
 {
     test_block();
@@ -553,4 +1171,15 @@ void test_rules(void)
     test_naming();
     test_runtime();
     test_whitespace();
+    test_changes();
+    test_nesting();
+    test_recovery();
+    test_parts();
+    test_jobs();
+    test_reuse();
+    test_messages();
+    test_cutoff();
+    test_names();
+    test_suppressions();
+    test_ranges();
 }
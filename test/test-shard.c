@@ -0,0 +1,159 @@
+/*!
+ * @brief Tests for shards and merging of their results.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clint.h"
+#include "helper.h"
+
+
+static const struct {
+    const char *path;
+    uint64_t size;
+} files[] = {
+    {"a.c", 100000}, {"b.c", 1}, {"c.c", 50000}, {"d.h", 50000},
+    {"e.c", 0}, {"f.c", 30000}, {"g.c", 20000}, {"h.h", 7}, {"i.c", 70000},
+};
+
+#define FILES_COUNT (sizeof(files) / sizeof(*files))
+
+
+//! Discovers files from `first` in a circle, so the order differs.
+static char **take(unsigned first, unsigned index, unsigned count)
+{
+    for (unsigned i = 0; i < FILES_COUNT; ++i)
+    {
+        unsigned j = (first + i) % FILES_COUNT;
+        discover_file(files[j].path, files[j].size);
+    }
+
+    return take_shard(index, count);
+}
+
+
+static void check_shards(unsigned count)
+{
+    bool taken[FILES_COUNT] = {false};
+
+    for (unsigned index = 1; index <= count; ++index)
+    {
+        char **mine = take(0, index, count), **other = take(5, index, count);
+
+        assert(vec_len(mine) == vec_len(other));
+
+        for (unsigned i = 0; i < vec_len(mine); ++i)
+        {
+            unsigned j = 0;
+
+            // The same files in the order of paths for any discovery.
+            assert(!strcmp(mine[i], other[i]));
+            assert(!i || strcmp(mine[i - 1], mine[i]) < 0);
+
+            while (strcmp(files[j].path, mine[i]))
+                ++j;
+
+            assert(!taken[j]);
+            taken[j] = true;
+        }
+
+        for (unsigned i = 0; i < vec_len(mine); ++i)
+        {
+            free(mine[i]);
+            free(other[i]);
+        }
+
+        free_vec(mine);
+        free_vec(other);
+    }
+
+    for (unsigned i = 0; i < FILES_COUNT; ++i)
+        assert(taken[i]);
+}
+
+
+//! Checks merged files as "file:line:column:rule ..." per file.
+static void check_merged(const char *expected)
+{
+    char actual[1024] = "";
+    size_t len = 0;
+
+    while (take_merged())
+    {
+        len += snprintf(actual + len, sizeof(actual) - len, "%s%s:",
+                        len ? "\n" : "", g_filename);
+
+        for (unsigned i = 0; i < vec_len(g_errors); ++i)
+            len += snprintf(actual + len, sizeof(actual) - len,
+                            " %u:%u:%s:%s", g_errors[i].line + 1,
+                            g_errors[i].column + 1,
+                            g_errors[i].rule ? g_errors[i].rule : "syntax",
+                            g_errors[i].message);
+
+        reset_state();
+    }
+
+    if (strcmp(actual, expected))
+    {
+        fprintf(stderr, "Actual:\n%s\nExpected:\n%s\n", actual, expected);
+        assert(0);
+    }
+}
+
+
+static bool read_text(const char *text, int *status)
+{
+    FILE *fp = open_text(text);
+    bool complete = read_result(fp, status);
+
+    fclose(fp);
+    return complete;
+}
+
+
+#define ERROR(file, line, rule, message)                                      \
+    "{\"file\": \"" file "\", \"line\": " #line ", \"column\": 1, "          \
+    "\"rule\": \"" rule "\", \"severity\": \"warning\", "                    \
+    "\"message\": \"" message "\"}\n"
+
+void test_shard(void)
+{
+    int status = -1;
+
+    group("shards");
+
+    test("all files once");
+    check_shards(1);
+    check_shards(2);
+    check_shards(3);
+    check_shards(FILES_COUNT + 2);
+
+    group("merging of results");
+
+    // Errors are sorted by files, each file keeps the order of its errors.
+    test("sorted by files");
+    assert(read_text(ERROR("b.c", 9, "lines", "B9")
+                     ERROR("a.c", 5, "naming", "A5")
+                     ERROR("b.c", 1, "syntax", "B1")
+                     "{\"status\": 1}\n", &status));
+    assert(status == 1);
+    assert(read_text(ERROR("a.c", 2, "lines", "A2")
+                     "{\"status\": 0}\n", &status));
+    assert(status == 0);
+    check_merged("a.c: 5:1:naming:A5 2:1:lines:A2\n"
+                 "b.c: 9:1:lines:B9 1:1:syntax:B1");
+    check_merged("");
+
+    test("broken results");
+    assert(!read_text(ERROR("a.c", 1, "lines", "A1"), &status));
+    assert(!read_text("{\"file\": \"a.c\"}\n{\"status\": 0}\n", &status));
+    assert(!read_text("{\"file\": \n{\"status\": 0}\n", &status));
+    assert(!read_text(ERROR("a.c", 0, "lines", "A0") "{\"status\": 0}\n",
+                      &status));
+    assert(!read_text("{\"status\": -1}\n", &status));
+    check_merged("a.c: 1:1:lines:A1");
+}
@@ -0,0 +1,261 @@
+/*!
+ * @brief Tests for reading tar archives.
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "clint.h"
+#include "helper.h"
+
+
+#define TAR_BLOCK 512
+
+//! The size field of GNU tar in base-256 instead of octal.
+#define BASE_256 ((uint64_t)1 << 63)
+
+
+//! Writes the ustar header, `size` can be marked by `BASE_256`.
+static void put_header(FILE *fp, const char *name, const char *prefix,
+                       char type, uint64_t size)
+{
+    unsigned char block[TAR_BLOCK] = {0};
+    unsigned sum = 0;
+
+    memcpy(block, name, strlen(name) < 100 ? strlen(name) : 100);
+
+    if (size & BASE_256)
+    {
+        size &= ~BASE_256;
+        block[124] = 0x80;
+
+        for (unsigned i = 135; i > 124; --i, size >>= 8)
+            block[i] = size & 0xff;
+    }
+    else
+        snprintf((char *)block + 124, 12, "%011o", (unsigned)size);
+
+    block[156] = type;
+    memcpy(block + 257, "ustar\0" "00", 8);
+
+    if (prefix)
+        memcpy(block + 345, prefix, strlen(prefix));
+
+    memset(block + 148, ' ', 8);
+
+    for (unsigned i = 0; i < TAR_BLOCK; ++i)
+        sum += block[i];
+
+    snprintf((char *)block + 148, 8, "%06o", sum);
+    fwrite(block, 1, TAR_BLOCK, fp);
+}
+
+
+//! Writes `size` bytes of `data` with the padding.
+static void put_data(FILE *fp, const char *data, size_t size)
+{
+    static const char zeros[TAR_BLOCK] = {0};
+
+    fwrite(data, 1, size, fp);
+    fwrite(zeros, 1, (TAR_BLOCK - size % TAR_BLOCK) % TAR_BLOCK, fp);
+}
+
+
+static void put_file(FILE *fp, const char *name, const char *data)
+{
+    put_header(fp, name, NULL, '0', strlen(data));
+    put_data(fp, data, strlen(data));
+}
+
+
+//! Writes the extended header of pax with the "path" record.
+static void put_pax_path(FILE *fp, const char *path)
+{
+    char records[1024];
+    unsigned len = strlen(" path=\n") + strlen(path), digits = 1;
+
+    // The length of a record counts its own digits.
+    while (len + digits >= (digits == 1 ? 10 : digits == 2 ? 100 : 1000))
+        ++digits;
+
+    snprintf(records, sizeof(records), "12 mtime=10\n%u path=%s\n",
+             len + digits, path);
+
+    put_header(fp, "PaxHeaders/a.c", NULL, 'x', strlen(records));
+    put_data(fp, records, strlen(records));
+}
+
+
+//! Writes the extended header of GNU tar with the long name.
+static void put_long_name(FILE *fp, const char *name)
+{
+    put_header(fp, "././@LongLink", NULL, 'L', strlen(name) + 1);
+    put_data(fp, name, strlen(name) + 1);
+}
+
+
+static void put_end(FILE *fp)
+{
+    static const char zeros[2 * TAR_BLOCK] = {0};
+    fwrite(zeros, 1, sizeof(zeros), fp);
+}
+
+
+/*!
+ * Reads the archive of `fp` as "name: content" lines of `.c` members, other
+ * members are skipped, so they have names only. Checks whether it ended.
+ */
+static void check(FILE *fp, const char *expected, bool ended)
+{
+    tar_t tar = {fp, NULL, NULL, false};
+    char actual[4096] = "", data[1024];
+    const char *name;
+    uint64_t size;
+    size_t len = 0;
+
+    rewind(fp);
+
+    while ((name = next_member(&tar, &size)))
+    {
+        char *ext = strrchr(name, '.');
+
+        if (ext && !strcmp(ext, ".c"))
+        {
+            assert(size < sizeof(data));
+            assert(read_member(&tar, data, size));
+            assert(strlen(data) == size);
+            len += snprintf(actual + len, sizeof(actual) - len, "%s: %s\n",
+                            name, data);
+        }
+        else
+        {
+            assert(skip_member(&tar, size));
+            len += snprintf(actual + len, sizeof(actual) - len, "%s\n", name);
+        }
+    }
+
+    free_tar(&tar);
+    fclose(fp);
+
+    if (strcmp(actual, expected))
+    {
+        fprintf(stderr, "Actual:\n%s\nExpected:\n%s\n", actual, expected);
+        assert(0);
+    }
+
+    assert(tar.ended == ended);
+}
+
+
+void test_tar(void)
+{
+    char name[301], block[TAR_BLOCK], expected[1024];
+    tar_t tar = {NULL, NULL, NULL, false};
+    uint64_t size;
+    FILE *fp;
+
+    group("tar archives");
+
+    test("members");
+    fp = tmpfile();
+    put_file(fp, "a.c", "int a;");
+    put_header(fp, "dir", NULL, '5', 0);
+    put_file(fp, "dir/readme", "text");
+    put_header(fp, "b.c", NULL, '7', 0);
+    put_file(fp, "c.c", "int c;");
+    put_end(fp);
+    check(fp, "a.c: int a;\ndir/readme\nb.c: \nc.c: int c;\n", true);
+
+    // Prefixes of ustar are joined with names.
+    test("prefixes");
+    memset(name, 'n', 100);
+    memcpy(name + 98, ".c", 3);
+    fp = tmpfile();
+    put_header(fp, "a.c", "dir/sub", '0', 6);
+    put_data(fp, "int a;", 6);
+    put_file(fp, name, "int b;");
+    put_end(fp);
+    snprintf(expected, sizeof(expected), "dir/sub/a.c: int a;\n%s: int b;\n",
+             name);
+    check(fp, expected, true);
+
+    // Extended headers name the next member only.
+    test("long names");
+    memset(name, 'n', 300);
+    memcpy(name + 298, ".c", 3);
+    fp = tmpfile();
+    put_long_name(fp, name);
+    put_file(fp, "short.c", "int a;");
+    put_file(fp, "b.c", "int b;");
+    put_pax_path(fp, "dir/pax.c");
+    put_file(fp, "PaxHeaders/x", "int c;");
+    put_long_name(fp, "dropped.c");
+    put_header(fp, "dir", NULL, '5', 0);
+    put_file(fp, "d.c", "int d;");
+    put_end(fp);
+    snprintf(expected, sizeof(expected),
+             "%s: int a;\nb.c: int b;\ndir/pax.c: int c;\nd.c: int d;\n",
+             name);
+    check(fp, expected, true);
+
+    test("sizes");
+    memset(block, 'x', TAR_BLOCK);
+    fp = tmpfile();
+    put_header(fp, "a.c", NULL, '0', 6 | BASE_256);
+    put_data(fp, "int a;", 6);
+    put_file(fp, "empty.c", "");
+    put_header(fp, "block", NULL, '0', TAR_BLOCK);
+    put_data(fp, block, TAR_BLOCK);
+    put_file(fp, "b.c", "int b;");
+    put_end(fp);
+    check(fp, "a.c: int a;\nempty.c: \nblock\nb.c: int b;\n", true);
+
+    // Two zero blocks end the archive, but one is enough at EOF.
+    test("ends");
+    fp = tmpfile();
+    put_file(fp, "a.c", "int a;");
+    put_end(fp);
+    put_file(fp, "b.c", "int b;");
+    check(fp, "a.c: int a;\n", true);
+
+    fp = tmpfile();
+    put_file(fp, "a.c", "int a;");
+    put_data(fp, "", 1);
+    check(fp, "a.c: int a;\n", true);
+
+    fp = tmpfile();
+    put_file(fp, "a.c", "int a;");
+    check(fp, "a.c: int a;\n", false);
+
+    test("broken archives");
+    fp = tmpfile();
+    put_file(fp, "a.c", "int a;");
+    put_file(fp, "b.c", "int b;");
+    put_end(fp);
+    fseek(fp, TAR_BLOCK * 2 + 148, SEEK_SET);
+    fputc('7', fp);
+    check(fp, "a.c: int a;\n", false);
+
+    fp = tmpfile();
+    put_long_name(fp, "a.c");
+    put_file(fp, "b.c", "int b;");
+    fflush(fp);
+    assert(!ftruncate(fileno(fp), TAR_BLOCK + 2));
+    check(fp, "", false);
+
+    fp = tmpfile();
+    put_file(fp, "a.c", "int a;");
+    fflush(fp);
+    assert(!ftruncate(fileno(fp), TAR_BLOCK + 2));
+    rewind(fp);
+    tar.fp = fp;
+    assert(!strcmp(next_member(&tar, &size), "a.c") && size == 6);
+    assert(!read_member(&tar, block, size));
+    free_tar(&tar);
+    fclose(fp);
+}